@@ -2,8 +2,142 @@
  * AoC 2021 Day 1 solution
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <immintrin.h>
+#include <signal.h>
+#include <unistd.h>
+
 #include "utils.h"
 
+/* Number of ints compared at once by the AVX2 path */
+#define AVX2_INTS_PER_VECTOR 8
+
+/* Size of the buffer used to read from a stream */
+#define STREAM_BUF_SIZE 65536
+
+/* Time to wait before checking a followed file for new data again */
+#define STREAM_POLL_INTERVAL_NS 100000000
+
+/* Set by a signal handler to stop streaming */
+static volatile sig_atomic_t stop_streaming = 0;
+
+/*
+ * find_number_increasing_scalar
+ *
+ * Scalar version of find_number_increasing_in_range(), used for the tail of
+ * the AVX2 path and on CPUs without AVX2.
+ *
+ * Argument: numbers_array
+ *     Array of integers.
+ * Argument: start
+ *     First index to compare. Must be at least num_previous_to_add.
+ * Argument: end
+ *     One past the last index to compare.
+ * Argument: num_previous_to_add
+ *     Number of values to consider in sum.
+ *
+ * Return: size_t
+ *
+ */
+static size_t
+find_number_increasing_scalar(int    *numbers_array,
+                              size_t  start,
+                              size_t  end,
+                              size_t  num_previous_to_add)
+{
+    size_t num_increasing = 0;
+    size_t i;
+
+    for (i = start; i < end; i++) {
+        num_increasing += (numbers_array[i] >
+                           numbers_array[i - num_previous_to_add]);
+    }
+
+    return (num_increasing);
+}
+
+/*
+ * find_number_increasing_avx2
+ *
+ * AVX2 version of find_number_increasing_in_range(), comparing
+ * AVX2_INTS_PER_VECTOR elements at a time.
+ *
+ * Argument: numbers_array
+ *     Array of integers.
+ * Argument: start
+ *     First index to compare. Must be at least num_previous_to_add.
+ * Argument: end
+ *     One past the last index to compare.
+ * Argument: num_previous_to_add
+ *     Number of values to consider in sum.
+ *
+ * Return: size_t
+ *
+ */
+__attribute__((target("avx2,popcnt")))
+static size_t
+find_number_increasing_avx2(int    *numbers_array,
+                            size_t  start,
+                            size_t  end,
+                            size_t  num_previous_to_add)
+{
+    size_t  num_increasing = 0;
+    size_t  i;
+    __m256i current, previous;
+    int     mask;
+
+    for (i = start; i + AVX2_INTS_PER_VECTOR <= end;
+         i += AVX2_INTS_PER_VECTOR) {
+        current = _mm256_loadu_si256((__m256i *) &numbers_array[i]);
+        previous = _mm256_loadu_si256(
+                  (__m256i *) &numbers_array[i - num_previous_to_add]);
+        mask = _mm256_movemask_ps(
+                _mm256_castsi256_ps(_mm256_cmpgt_epi32(current, previous)));
+        num_increasing += __builtin_popcount(mask);
+    }
+
+    num_increasing += find_number_increasing_scalar(numbers_array, i, end,
+                                                    num_previous_to_add);
+
+    return (num_increasing);
+}
+
+/*
+ * find_number_increasing_in_range
+ *
+ * Count the indices i in [start, end) where element i is larger than element
+ * i-num_previous_to_add. Uses AVX2 if the CPU supports it.
+ *
+ * Argument: numbers_array
+ *     Array of integers.
+ * Argument: start
+ *     First index to compare. Must be at least num_previous_to_add.
+ * Argument: end
+ *     One past the last index to compare.
+ * Argument: num_previous_to_add
+ *     Number of values to consider in sum.
+ *
+ * Return: size_t
+ *
+ */
+static size_t
+find_number_increasing_in_range(int    *numbers_array,
+                                size_t  start,
+                                size_t  end,
+                                size_t  num_previous_to_add)
+{
+    assert(start >= num_previous_to_add);
+
+    if (__builtin_cpu_supports("avx2")) {
+        return (find_number_increasing_avx2(numbers_array, start, end,
+                                            num_previous_to_add));
+    }
+
+    return (find_number_increasing_scalar(numbers_array, start, end,
+                                          num_previous_to_add));
+}
+
 /*
  * find_number_increasing
  *
@@ -11,6 +145,9 @@
  * i, i-1, ..., i-num_previous_to_add is smaller than the sum of the elements
  * i-1, i-2, ..., i-num_previous_to_add-1.
  *
+ * The two sums share all but one element each, so this is the same as
+ * counting where element i is larger than element i-num_previous_to_add.
+ *
  * Argument: numbers_array
  *     Array of integers.
  * Argument: len
@@ -26,27 +163,813 @@ find_number_increasing(int    *numbers_array,
                        size_t  len,
                        size_t  num_previous_to_add)
 {
-    size_t num_increasing = 0;
+    assert(num_previous_to_add > 0);
+    assert(num_previous_to_add <= len);
+
+    return (find_number_increasing_in_range(numbers_array,
+                                            num_previous_to_add, len,
+                                            num_previous_to_add));
+}
+
+/*
+ * depth_windows_type
+ *
+ * Running state for counting increasing windows over a stream of depths.
+ * Only the last max(window_sizes) depths are kept, in a ring buffer, so
+ * memory is fixed once made.
+ *
+ * Element: ring
+ *     Ring buffer of the most recent depths.
+ * Element: ring_mask
+ *     One less than the ring buffer size, which is a power of 2.
+ * Element: window_sizes
+ *     Array of the number of values to consider in each sum.
+ * Element: num_increasing
+ *     Array of the count of increases so far for each window size.
+ * Element: num_windows
+ *     Number of elements in window_sizes and num_increasing.
+ * Element: num_values
+ *     Number of depths seen so far.
+ * Element: value
+ *     Digits parsed so far of a depth which may continue in the next chunk of
+ *     text.
+ * Element: in_number
+ *     Whether value holds a partially parsed depth.
+ * Element: report_interval
+ *     Print the counts every this many depths. 0 to never print.
+ */
+typedef struct Depth_Windows {
+    int    *ring;
+    size_t  ring_mask;
+    size_t *window_sizes;
+    size_t *num_increasing;
+    size_t  num_windows;
+    size_t  num_values;
+    int     value;
+    bool    in_number;
+    size_t  report_interval;
+} depth_windows_type;
+
+/*
+ * make_depth_windows
+ *
+ * Allocate and initialise a depth_windows struct. The returned struct must be
+ * freed with free_depth_windows().
+ *
+ * Argument: window_sizes
+ *     Array of the number of values to consider in each sum.
+ * Argument: num_windows
+ *     Number of elements in window_sizes.
+ * Argument: report_interval
+ *     Print the counts every this many depths. 0 to never print.
+ *
+ * Return: depth_windows_type
+ *
+ */
+static depth_windows_type
+make_depth_windows(size_t *window_sizes,
+                   size_t  num_windows,
+                   size_t  report_interval)
+{
+    depth_windows_type windows;
+    size_t             max_window = 0;
+    size_t             i;
+
+    windows.window_sizes = malloc_b(num_windows * sizeof(size_t));
+    windows.num_increasing = calloc_b(num_windows, sizeof(size_t));
+    windows.num_windows = num_windows;
+    for (i = 0; i < num_windows; i++) {
+        assert(window_sizes[i] > 0);
+        windows.window_sizes[i] = window_sizes[i];
+        max_window = MAX(max_window, window_sizes[i]);
+    }
+
+    /* Round up to a power of 2 so the ring can be indexed with a mask */
+    windows.ring_mask = 1;
+    while (windows.ring_mask < max_window) {
+        windows.ring_mask <<= 1;
+    }
+    windows.ring = malloc_b(windows.ring_mask * sizeof(int));
+    windows.ring_mask--;
+
+    windows.num_values = 0;
+    windows.value = 0;
+    windows.in_number = false;
+    windows.report_interval = report_interval;
+
+    return (windows);
+}
+
+/*
+ * free_depth_windows
+ *
+ * Free allocated memory from the depth_windows struct.
+ *
+ * Argument: windows
+ *     depth_windows_type struct to free.
+ *
+ * Return: void
+ *
+ */
+static void
+free_depth_windows(depth_windows_type *windows)
+{
+    free(windows->ring);
+    windows->ring = NULL;
+    free(windows->window_sizes);
+    windows->window_sizes = NULL;
+    free(windows->num_increasing);
+    windows->num_increasing = NULL;
+    windows->num_windows = 0;
+}
+
+/*
+ * print_depth_windows
+ *
+ * Print the number of depths seen and the count of increases for each window
+ * size.
+ *
+ * Argument: windows
+ *     depth_windows_type struct to print.
+ *
+ * Return: void
+ *
+ */
+static void
+print_depth_windows(depth_windows_type *windows)
+{
+    size_t i;
+
+    printf("Depths = %zu", windows->num_values);
+    for (i = 0; i < windows->num_windows; i++) {
+        printf(", increasing last %zu = %zu",
+               windows->window_sizes[i], windows->num_increasing[i]);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+/*
+ * add_depth
+ *
+ * Compare a new depth against the ring buffer for every window size, then
+ * store it. O(num_windows) with no allocation.
+ *
+ * Argument: windows
+ *     Running state to add the depth to.
+ * Argument: depth
+ *     Depth to add.
+ *
+ * Return: void
+ *
+ */
+static void
+add_depth(depth_windows_type *windows, int depth)
+{
+    size_t num_values = windows->num_values;
+    size_t i;
+
+    for (i = 0; i < windows->num_windows; i++) {
+        if (num_values >= windows->window_sizes[i]) {
+            windows->num_increasing[i] += (depth >
+                windows->ring[(num_values - windows->window_sizes[i])
+                              & windows->ring_mask]);
+        }
+    }
+    windows->ring[num_values & windows->ring_mask] = depth;
+    windows->num_values++;
+
+    if (windows->report_interval != 0 &&
+        windows->num_values % windows->report_interval == 0) {
+        print_depth_windows(windows);
+    }
+}
+
+/*
+ * add_depths_from_text
+ *
+ * Parse depths from a chunk of text and add each one. A depth may be split
+ * across chunks, in which case its digits so far are carried over to the
+ * next call.
+ *
+ * Argument: windows
+ *     Running state to add the depths to.
+ * Argument: text
+ *     Chunk of text of one non-negative integer per line.
+ * Argument: len
+ *     Number of bytes in text.
+ *
+ * Return: void
+ *
+ */
+static void
+add_depths_from_text(depth_windows_type *windows, char *text, size_t len)
+{
     size_t i;
-    int    previous_sum = 0;
-    int    current_sum = 0;
+
+    for (i = 0; i < len; i++) {
+        if (text[i] >= '0' && text[i] <= '9') {
+            windows->value = windows->value * 10 + (text[i] - '0');
+            windows->in_number = true;
+        } else if (windows->in_number) {
+            add_depth(windows, windows->value);
+            windows->value = 0;
+            windows->in_number = false;
+        }
+    }
+}
+
+/*
+ * finish_depths
+ *
+ * Add the last depth if the text did not end with a newline.
+ *
+ * Argument: windows
+ *     Running state to finish.
+ *
+ * Return: void
+ *
+ */
+static void
+finish_depths(depth_windows_type *windows)
+{
+    if (windows->in_number) {
+        add_depth(windows, windows->value);
+        windows->value = 0;
+        windows->in_number = false;
+    }
+}
+
+/*
+ * find_number_increasing_from_text
+ *
+ * Same as find_number_increasing(), but for several window sizes at once and
+ * parsing the depths straight from text in a single pass, so the whole input
+ * is never converted to an array.
+ *
+ * Argument: text
+ *     Text of one non-negative integer per line.
+ * Argument: len
+ *     Number of bytes in text.
+ * Argument: window_sizes
+ *     Array of the number of values to consider in each sum.
+ * Argument: num_windows
+ *     Number of elements in window_sizes.
+ * Argument: num_increasing
+ *     OUT: Array of num_windows elements to write the count for each window
+ *     size into.
+ *
+ * Return: void
+ *
+ */
+static void
+find_number_increasing_from_text(char   *text,
+                                 size_t  len,
+                                 size_t *window_sizes,
+                                 size_t  num_windows,
+                                 size_t *num_increasing)
+{
+    depth_windows_type windows;
+
+    windows = make_depth_windows(window_sizes, num_windows, 0);
+    add_depths_from_text(&windows, text, len);
+    finish_depths(&windows);
+
+    memcpy(num_increasing, windows.num_increasing,
+           num_windows * sizeof(size_t));
+
+    free_depth_windows(&windows);
+}
+
+/*
+ * handle_stop_signal
+ *
+ * Signal handler to stop streaming.
+ */
+static void
+handle_stop_signal(int signal_number)
+{
+    stop_streaming = 1;
+}
+
+/*
+ * stream_depths
+ *
+ * Read depths from stdin or a file as they arrive, printing the running
+ * counts every report_interval depths and once more at the end. Stdin is read
+ * until EOF. A file is followed as it is appended to, like `tail -f`, until
+ * interrupted. All memory is allocated up front, and each depth is O(1).
+ *
+ * Argument: file_name
+ *     File to read depths from, or "-" for stdin.
+ * Argument: report_interval
+ *     Print the counts every this many depths. 0 to only print at the end.
+ *
+ * Return: void
+ *
+ */
+static void
+stream_depths(char *file_name, size_t report_interval)
+{
+    depth_windows_type  windows;
+    size_t              window_sizes[2] = {1, 3};
+    char                buf[STREAM_BUF_SIZE];
+    struct sigaction    action;
+    struct timespec     poll_time = {0, STREAM_POLL_INTERVAL_NS};
+    bool                is_following;
+    ssize_t             num_read;
+    int                 fd;
+
+    is_following = !STRS_EQUAL(file_name, "-");
+    if (is_following) {
+        fd = open(file_name, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Error opening file %s\n", file_name);
+            assert(false);
+        }
+    } else {
+        fd = STDIN_FILENO;
+    }
+
+    /* No SA_RESTART, so a blocking read is interrupted too */
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    windows = make_depth_windows(window_sizes, 2, report_interval);
+
+    while (!stop_streaming) {
+        num_read = read(fd, buf, STREAM_BUF_SIZE);
+        if (num_read > 0) {
+            add_depths_from_text(&windows, buf, num_read);
+        } else if (num_read == 0 && is_following) {
+            /* At the current end of the file, wait for more to be written */
+            nanosleep(&poll_time, NULL);
+        } else if (num_read < 0 && errno == EINTR) {
+            continue;
+        } else {
+            break;
+        }
+    }
+
+    finish_depths(&windows);
+    if (report_interval == 0 || windows.num_values % report_interval != 0) {
+        /* Not already printed by the last report */
+        print_depth_windows(&windows);
+    }
+
+    free_depth_windows(&windows);
+    if (is_following) {
+        close(fd);
+    }
+}
+
+/*
+ * increasing_chunk_type
+ *
+ * Work for one thread of a parallel count.
+ *
+ * Element: numbers_array
+ *     Array of integers, for counting over an array.
+ * Element: text
+ *     Text of one integer per line, for counting over text.
+ * Element: overlap_start
+ *     Start of the text before this chunk needed to fill the windows, so the
+ *     first depths in the chunk can be compared.
+ * Element: start
+ *     First index (or text offset) of the chunk.
+ * Element: end
+ *     One past the last index (or text offset) of the chunk.
+ * Element: window_sizes
+ *     Array of the number of values to consider in each sum.
+ * Element: num_windows
+ *     Number of elements in window_sizes and num_increasing.
+ * Element: num_increasing
+ *     OUT: Array of the count of increases in the chunk for each window size.
+ */
+typedef struct Increasing_Chunk {
+    int    *numbers_array;
+    char   *text;
+    size_t  overlap_start;
+    size_t  start;
+    size_t  end;
+    size_t *window_sizes;
+    size_t  num_windows;
+    size_t *num_increasing;
+} increasing_chunk_type;
+
+/*
+ * count_increasing_in_array_chunk
+ *
+ * Thread function counting increases over a chunk of an array, for a single
+ * window size. Elements before the chunk are read directly for the overlap.
+ *
+ * Argument: arg
+ *     Pointer to the increasing_chunk_type for this thread.
+ *
+ * Return: void *
+ */
+static void *
+count_increasing_in_array_chunk(void *arg)
+{
+    increasing_chunk_type *chunk = arg;
+
+    chunk->num_increasing[0] = find_number_increasing_in_range(
+                                                       chunk->numbers_array,
+                                                       chunk->start,
+                                                       chunk->end,
+                                                       chunk->window_sizes[0]);
+
+    return (NULL);
+}
+
+/*
+ * count_increasing_in_text_chunk
+ *
+ * Thread function counting increases over a chunk of text. The lines between
+ * overlap_start and start are parsed first to fill the windows, then their
+ * counts are discarded as they belong to the previous chunk.
+ *
+ * Argument: arg
+ *     Pointer to the increasing_chunk_type for this thread.
+ *
+ * Return: void *
+ */
+static void *
+count_increasing_in_text_chunk(void *arg)
+{
+    increasing_chunk_type *chunk = arg;
+    depth_windows_type     windows;
+
+    if (chunk->start == chunk->end) {
+        /*
+         * More threads than lines. The overlap may end part way through the
+         * last depth if there is no final newline, so skip it entirely.
+         */
+        memset(chunk->num_increasing, 0, chunk->num_windows * sizeof(size_t));
+        return (NULL);
+    }
+
+    windows = make_depth_windows(chunk->window_sizes, chunk->num_windows, 0);
+
+    add_depths_from_text(&windows, chunk->text + chunk->overlap_start,
+                         chunk->start - chunk->overlap_start);
+    memset(windows.num_increasing, 0, chunk->num_windows * sizeof(size_t));
+
+    add_depths_from_text(&windows, chunk->text + chunk->start,
+                         chunk->end - chunk->start);
+    finish_depths(&windows);
+
+    memcpy(chunk->num_increasing, windows.num_increasing,
+           chunk->num_windows * sizeof(size_t));
+
+    free_depth_windows(&windows);
+
+    return (NULL);
+}
+
+/*
+ * run_increasing_chunks
+ *
+ * Run a thread function over every chunk and sum the counts of each window
+ * size.
+ *
+ * Argument: chunks
+ *     Array of chunks, one per thread.
+ * Argument: num_threads
+ *     Number of elements in chunks.
+ * Argument: thread_func
+ *     Function to run on each chunk.
+ * Argument: num_increasing
+ *     OUT: Array of num_windows elements to write the total counts into.
+ *
+ * Return: void
+ */
+static void
+run_increasing_chunks(increasing_chunk_type  *chunks,
+                      size_t                  num_threads,
+                      void                 *(*thread_func)(void *),
+                      size_t                 *num_increasing)
+{
+    size_t i, j;
+
+    run_threads(chunks, sizeof(increasing_chunk_type), num_threads,
+                thread_func);
+
+    for (j = 0; j < chunks[0].num_windows; j++) {
+        num_increasing[j] = 0;
+    }
+    for (i = 0; i < num_threads; i++) {
+        for (j = 0; j < chunks[i].num_windows; j++) {
+            num_increasing[j] += chunks[i].num_increasing[j];
+        }
+    }
+}
+
+/*
+ * find_number_increasing_parallel
+ *
+ * Same as find_number_increasing(), but splitting the array into one chunk
+ * per thread. Each chunk reads the num_previous_to_add elements before it, so
+ * the chunks can be counted independently and summed.
+ *
+ * Argument: numbers_array
+ *     Array of integers.
+ * Argument: len
+ *     Length of numbers_array.
+ * Argument: num_previous_to_add
+ *     Number of values to consider in sum.
+ * Argument: num_threads
+ *     Number of threads to use.
+ *
+ * Return: size_t
+ */
+static size_t
+find_number_increasing_parallel(int    *numbers_array,
+                                size_t  len,
+                                size_t  num_previous_to_add,
+                                size_t  num_threads)
+{
+    increasing_chunk_type *chunks = NULL;
+    size_t                *chunk_counts = NULL;
+    size_t                 num_to_compare;
+    size_t                 num_increasing;
+    size_t                 i;
 
     assert(num_previous_to_add > 0);
     assert(num_previous_to_add <= len);
+    assert(num_threads > 0);
+
+    chunks = malloc_b(num_threads * sizeof(increasing_chunk_type));
+    chunk_counts = malloc_b(num_threads * sizeof(size_t));
+
+    num_to_compare = len - num_previous_to_add;
+    for (i = 0; i < num_threads; i++) {
+        chunks[i].numbers_array = numbers_array;
+        chunks[i].start = num_previous_to_add +
+                          num_to_compare * i / num_threads;
+        chunks[i].end = num_previous_to_add +
+                        num_to_compare * (i + 1) / num_threads;
+        chunks[i].window_sizes = &num_previous_to_add;
+        chunks[i].num_windows = 1;
+        chunks[i].num_increasing = &chunk_counts[i];
+    }
+
+    run_increasing_chunks(chunks, num_threads,
+                          count_increasing_in_array_chunk, &num_increasing);
+
+    free(chunk_counts);
+    chunk_counts = NULL;
+    free(chunks);
+    chunks = NULL;
+
+    return (num_increasing);
+}
+
+/*
+ * find_start_of_previous_lines
+ *
+ * Find the start of the line num_lines lines before a line start in the
+ * text, or the start of the text if there are not that many lines.
+ *
+ * Argument: text
+ *     Text to search.
+ * Argument: line_start
+ *     Offset of the start of a line.
+ * Argument: num_lines
+ *     Number of lines to go back.
+ *
+ * Return: size_t
+ */
+static size_t
+find_start_of_previous_lines(char *text, size_t line_start, size_t num_lines)
+{
+    size_t pos = line_start;
+
+    while (pos > 0 && num_lines > 0) {
+        /* Step onto the newline ending the previous line, then to its start */
+        pos--;
+        while (pos > 0 && text[pos - 1] != '\n') {
+            pos--;
+        }
+        num_lines--;
+    }
+
+    return (pos);
+}
+
+/*
+ * find_number_increasing_from_text_parallel
+ *
+ * Same as find_number_increasing_from_text(), but splitting the text into one
+ * chunk per thread at line boundaries. Each chunk also parses the
+ * max(window_sizes) lines before it, so the chunks can be counted
+ * independently and summed.
+ *
+ * Argument: text
+ *     Text of one non-negative integer per line. Does not need to be null
+ *     terminated, so can be a mapped file.
+ * Argument: len
+ *     Number of bytes in text.
+ * Argument: window_sizes
+ *     Array of the number of values to consider in each sum.
+ * Argument: num_windows
+ *     Number of elements in window_sizes.
+ * Argument: num_threads
+ *     Number of threads to use.
+ * Argument: num_increasing
+ *     OUT: Array of num_windows elements to write the count for each window
+ *     size into.
+ *
+ * Return: void
+ */
+static void
+find_number_increasing_from_text_parallel(char   *text,
+                                          size_t  len,
+                                          size_t *window_sizes,
+                                          size_t  num_windows,
+                                          size_t  num_threads,
+                                          size_t *num_increasing)
+{
+    increasing_chunk_type *chunks = NULL;
+    size_t                *chunk_counts = NULL;
+    size_t                 max_window = 0;
+    size_t                 boundary;
+    size_t                 i;
+
+    assert(num_threads > 0);
+
+    for (i = 0; i < num_windows; i++) {
+        max_window = MAX(max_window, window_sizes[i]);
+    }
+
+    chunks = malloc_b(num_threads * sizeof(increasing_chunk_type));
+    chunk_counts = malloc_b(num_threads * num_windows * sizeof(size_t));
+
+    boundary = 0;
+    for (i = 0; i < num_threads; i++) {
+        chunks[i].text = text;
+        chunks[i].start = boundary;
+
+        /* End the chunk just after a newline so no depth is split */
+        boundary = find_line_boundary(text, len,
+                                      MAX(boundary,
+                                          len * (i + 1) / num_threads));
+        chunks[i].end = boundary;
+
+        chunks[i].overlap_start = find_start_of_previous_lines(
+                                                          text,
+                                                          chunks[i].start,
+                                                          max_window);
+        chunks[i].window_sizes = window_sizes;
+        chunks[i].num_windows = num_windows;
+        chunks[i].num_increasing = &chunk_counts[i * num_windows];
+    }
+
+    run_increasing_chunks(chunks, num_threads,
+                          count_increasing_in_text_chunk, num_increasing);
+
+    free(chunk_counts);
+    chunk_counts = NULL;
+    free(chunks);
+    chunks = NULL;
+}
+
+/*
+ * parse_depths_from_text
+ *
+ * Parse text of one non-negative integer per line into an array. The memory
+ * of the returned array must be freed by the caller.
+ *
+ * Argument: text
+ *     Text to parse. Does not need to be null terminated.
+ * Argument: len
+ *     Number of bytes in text.
+ * Argument: num_depths
+ *     OUT: Number of elements in the returned array.
+ *
+ * Return: int *
+ */
+static int *
+parse_depths_from_text(char *text, size_t len, size_t *num_depths)
+{
+    int    *numbers_array = NULL;
+    size_t  num_lines = 1;
+    size_t  i;
+    int     value = 0;
+    bool    in_number = false;
+
+    for (i = 0; i < len; i++) {
+        num_lines += (text[i] == '\n');
+    }
+    numbers_array = malloc_b(num_lines * sizeof(int));
 
-    for (i = num_previous_to_add; i < len; i++) {
-        previous_sum = 0;
-        current_sum = 0;
-        for (int j = 0; j < num_previous_to_add; j++) {
-            previous_sum += numbers_array[i-j-1];
-            current_sum += numbers_array[i-j];
+    *num_depths = 0;
+    for (i = 0; i <= len; i++) {
+        if (i < len && text[i] >= '0' && text[i] <= '9') {
+            value = value * 10 + (text[i] - '0');
+            in_number = true;
+        } else if (in_number) {
+            numbers_array[(*num_depths)++] = value;
+            value = 0;
+            in_number = false;
         }
-        if (current_sum > previous_sum) {
-            num_increasing++;
+    }
+
+    return (numbers_array);
+}
+
+/*
+ * report_scaling
+ *
+ * Time the scalar, single-thread AVX2 and parallel versions of both parts on
+ * a file, for every thread count from 1 to the number of online cores, and
+ * check they all agree.
+ *
+ * Argument: file_name
+ *     File of depths to time on.
+ *
+ * Return: void
+ */
+static void
+report_scaling(char *file_name)
+{
+    char            *text = NULL;
+    size_t           text_len;
+    int             *numbers_array = NULL;
+    size_t           num_depths;
+    size_t           window_sizes[2] = {1, 3};
+    size_t           expected[2];
+    size_t           num_increasing[2];
+    size_t           num_threads, max_threads;
+    struct timespec  start_time, end_time;
+    char             description[64];
+    size_t           i;
+
+    text = map_file(file_name, &text_len);
+    numbers_array = parse_depths_from_text(text, text_len, &num_depths);
+    max_threads = MAX(1, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%zu depths, %zu cores\n", num_depths, max_threads);
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+    for (i = 0; i < 2; i++) {
+        expected[i] = find_number_increasing_scalar(numbers_array,
+                                                    window_sizes[i],
+                                                    num_depths,
+                                                    window_sizes[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+    print_elapsed_time(find_elapsed_time_ns(start_time, end_time),
+                       "Array, scalar");
+    printf("Part 1 = %zu, Part 2 = %zu\n", expected[0], expected[1]);
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+    for (i = 0; i < 2; i++) {
+        num_increasing[i] = find_number_increasing(numbers_array, num_depths,
+                                                   window_sizes[i]);
+        assert(num_increasing[i] == expected[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+    print_elapsed_time(find_elapsed_time_ns(start_time, end_time),
+                       "Array, 1 thread");
+
+    for (num_threads = 1; num_threads <= max_threads; num_threads++) {
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+        for (i = 0; i < 2; i++) {
+            num_increasing[i] = find_number_increasing_parallel(
+                                                             numbers_array,
+                                                             num_depths,
+                                                             window_sizes[i],
+                                                             num_threads);
+            assert(num_increasing[i] == expected[i]);
         }
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+        snprintf(description, sizeof(description), "Array, %zu threads",
+                 num_threads);
+        print_elapsed_time(find_elapsed_time_ns(start_time, end_time),
+                           description);
     }
 
-    return (num_increasing);
+    for (num_threads = 1; num_threads <= max_threads; num_threads++) {
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+        find_number_increasing_from_text_parallel(text, text_len,
+                                                  window_sizes, 2,
+                                                  num_threads,
+                                                  num_increasing);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+        assert(num_increasing[0] == expected[0]);
+        assert(num_increasing[1] == expected[1]);
+        snprintf(description, sizeof(description),
+                 "Mapped text, %zu threads", num_threads);
+        print_elapsed_time(find_elapsed_time_ns(start_time, end_time),
+                           description);
+    }
+
+    free(numbers_array);
+    numbers_array = NULL;
+    munmap(text, text_len);
+    text = NULL;
 }
 
 /*
@@ -65,39 +988,53 @@ find_number_increasing(int    *numbers_array,
 static void
 runner(char *file_name, bool print_output)
 {
-    parsed_text_type  parsed_text;
-    int              *numbers_array = NULL;
-    size_t            num_increasing;
-
-    parsed_text = parse_file(file_name);
-
-    numbers_array = parse_text_to_ints(parsed_text);
+    char   *text = NULL;
+    size_t  text_len;
+    size_t  window_sizes[2] = {1, 3};
+    size_t  num_increasing[2];
 
-    num_increasing = find_number_increasing(numbers_array,
-                                            parsed_text.num_lines, 1);
-    if (print_output) {
-        printf("Part 1: Number of increasing depths = %zu\n", num_increasing);
-    }
+    text = read_file_to_buffer(file_name, &text_len);
 
-    num_increasing = find_number_increasing(numbers_array,
-                                            parsed_text.num_lines, 3);
+    find_number_increasing_from_text(text, text_len, window_sizes, 2,
+                                     num_increasing);
     if (print_output) {
+        printf("Part 1: Number of increasing depths = %zu\n",
+               num_increasing[0]);
         printf("Part 2: Number of increasing last 3 depths = %zu\n",
-               num_increasing);
+               num_increasing[1]);
     }
 
-    free(numbers_array);
-    free_parsed_text(parsed_text);
+    free(text);
+    text = NULL;
 }
 
 /*
  * Main function.
+ *
+ * Usage:
+ *   day_01 <file>
+ *       Solve both parts for a complete file.
+ *   day_01 --stream <file|-> [report_interval]
+ *       Stream depths from stdin ("-") or follow an appended file, printing
+ *       running counts every report_interval depths.
+ *   day_01 --scaling <file>
+ *       Time the scalar and parallel versions on a file for 1 to all cores.
  */
 int
 main(int argc, char **argv)
 {
     char *file_name = NULL;
 
+    if (argc >= 3 && STRS_EQUAL(argv[1], "--stream")) {
+        assert(argc <= 4);
+        stream_depths(argv[2], argc == 4 ? strtoul(argv[3], NULL, 10) : 0);
+        return (0);
+    }
+    if (argc == 3 && STRS_EQUAL(argv[1], "--scaling")) {
+        report_scaling(argv[2]);
+        return (0);
+    }
+
     assert(argc == 2);
     file_name = argv[1];
 
@@ -2,15 +2,18 @@
  * AoC 2021 Day 2 solution
  */
 
-#include "utils.h"
+#include <inttypes.h>
+#include <unistd.h>
 
-/* Maximum length of a direction string (strlen("forward")+1)*/
-#define DIRECTION_STR_MAX_SIZE 8
+#include "utils.h"
 
-/* Macros for easily identifying direction strings */
-#define IS_FORWARD(str) (STRS_EQUAL(str, "forward"))
-#define IS_DOWN(str)    (STRS_EQUAL(str, "down"))
-#define IS_UP(str)      (STRS_EQUAL(str, "up"))
+/*
+ * Length of each command word plus the following space, so the distance can
+ * be jumped to once the command is known from its first byte.
+ */
+#define FORWARD_PREFIX_LEN (sizeof("forward ") - 1)
+#define DOWN_PREFIX_LEN    (sizeof("down ") - 1)
+#define UP_PREFIX_LEN      (sizeof("up ") - 1)
 
 /*
  * position_type
@@ -23,35 +26,11 @@
  *     Current aim of the ship (unused in part 1).
  */
 typedef struct Position {
-    int horizontal;
-    int depth;
-    int aim;
+    int64_t horizontal;
+    int64_t depth;
+    int64_t aim;
 } position_type;
 
-/*
- * direction_enum_type
- *
- * Enum of possible directions the ship can go.
- */
-typedef enum Direction {
-    FORWARD,
-    DOWN,
-    UP,
-} direction_enum_type;
-
-/*
- * instruction_type
- *
- * Element: direction
- *     Enum value of direction.
- * Element: distance
- *     Distance to travel in direction.
- */
-typedef struct Instruction {
-    direction_enum_type direction;
-    int                 distance;
-} instruction_type;
-
 /*
  * initialise_position_type
  *
@@ -72,113 +51,460 @@ initialise_position_type(position_type *position)
 }
 
 /*
- * parse_line_bag_colours
+ * command_chunk_type
  *
- * Parses the colour of the bag in the input line.
+ * Work for one thread of a parallel scan over commands.
  *
- * Argument: direction
- *     Bag struct to parse into.
- * Argument: distance
- *     Line to parse.
+ * Element: text
+ *     Text of all the commands.
+ * Element: start
+ *     Offset of the first command in the chunk.
+ * Element: end
+ *     One past the offset of the last command in the chunk.
+ * Element: delta
+ *     OUT: Position reached by applying the chunk's commands from the origin.
+ *     Composed with combine_positions().
+ * Element: num_commands
+ *     OUT: Number of commands in the chunk.
+ * Element: start_position
+ *     Position before the chunk's first command, for the trajectory pass.
+ * Element: first_command
+ *     Index of the chunk's first command among all commands.
+ * Element: sample_interval
+ *     Record the position after every this many commands overall.
+ * Element: trajectory
+ *     Array of sampled positions shared by all chunks, or NULL for none.
+ */
+typedef struct Command_Chunk {
+    char          *text;
+    size_t         start;
+    size_t         end;
+    position_type  delta;
+    size_t         num_commands;
+    position_type  start_position;
+    size_t         first_command;
+    size_t         sample_interval;
+    position_type *trajectory;
+} command_chunk_type;
+
+/*
+ * apply_commands
  *
- * Return: void
+ * Parse instructions straight from the text and apply them to a position
+ * using the part 2 rules. Each command is identified by its first byte, then
+ * the distance is parsed in place.
+ *
+ * Part 1's depth changes exactly as part 2's aim does, so the result holds
+ * both parts' answers.
+ *
+ * Argument: text
+ *     Text of one "<direction> <distance>" instruction per line.
+ * Argument: len
+ *     Number of bytes in text.
+ * Argument: position
+ *     Position to apply the commands to. Updated in place.
+ * Argument: first_command
+ *     Index of the first command in text among all commands, for sampling.
+ * Argument: sample_interval
+ *     Record the position after every this many commands overall. Unused if
+ *     trajectory is NULL.
+ * Argument: trajectory
+ *     OUT: Array to write sampled positions into, where element i is the
+ *     position after (i + 1) * sample_interval commands. NULL to not sample.
+ *
+ * Return: size_t
+ *     Number of commands applied.
  *
  */
-static instruction_type
-parse_line_from_instruction(char *line)
+static size_t
+apply_commands(char          *text,
+               size_t         len,
+               position_type *position,
+               size_t         first_command,
+               size_t         sample_interval,
+               position_type *trajectory)
 {
-    instruction_type instruction;
-    char             direction[DIRECTION_STR_MAX_SIZE] = "";
-    int              distance;
-
-    sscanf(line, "%s %d", direction, &distance);
-
-    if (IS_FORWARD(direction)) {
-        instruction.direction = FORWARD;
-    } else if (IS_DOWN(direction)) {
-        instruction.direction = DOWN;
-    } else if (IS_UP(direction)) {
-        instruction.direction = UP;
-    } else {
-        assert(false);
+    int64_t  horizontal = position->horizontal;
+    int64_t  aim = position->aim;
+    int64_t  depth = position->depth;
+    int64_t  distance;
+    size_t   command = first_command;
+    size_t   next_sample = SIZE_MAX;
+    char     direction;
+    size_t   i = 0;
+
+    if (trajectory != NULL) {
+        next_sample = (first_command / sample_interval + 1) * sample_interval;
+    }
+
+    while (i < len) {
+        direction = text[i];
+        if (direction == 'f') {
+            i += FORWARD_PREFIX_LEN;
+        } else if (direction == 'd') {
+            i += DOWN_PREFIX_LEN;
+        } else if (direction == 'u') {
+            i += UP_PREFIX_LEN;
+        } else {
+            /* Newline or other whitespace between commands */
+            assert(isspace(direction));
+            i++;
+            continue;
+        }
+
+        distance = 0;
+        while (i < len && text[i] >= '0' && text[i] <= '9') {
+            distance = distance * 10 + (text[i] - '0');
+            i++;
+        }
+
+        if (direction == 'f') {
+            horizontal += distance;
+            depth += distance * aim;
+        } else if (direction == 'd') {
+            aim += distance;
+        } else {
+            aim -= distance;
+        }
+
+        if (++command == next_sample) {
+            trajectory[command / sample_interval - 1].horizontal = horizontal;
+            trajectory[command / sample_interval - 1].depth = depth;
+            trajectory[command / sample_interval - 1].aim = aim;
+            next_sample += sample_interval;
+        }
     }
 
-    instruction.distance = distance;
+    position->horizontal = horizontal;
+    position->depth = depth;
+    position->aim = aim;
 
-    return (instruction);
+    return (command - first_command);
 }
 
 /*
- * calculate_final_position_part_1
+ * combine_positions
  *
- * Parse instructions from lines and calculate the final position.
+ * Compose two runs of commands, each given as the position they reach from
+ * the origin. Commands form a monoid under this, so runs can be reduced in
+ * any grouping:
+ *     horizontal = a.horizontal + b.horizontal
+ *     aim        = a.aim + b.aim
+ *     depth      = a.depth + b.depth + a.aim * b.horizontal
+ * since each forward in b also moves down by a's aim.
  *
- * Argument: parsed_text
- *     Parsed text from input file.
+ * Argument: a
+ *     First run of commands.
+ * Argument: b
+ *     Run of commands following a.
  *
  * Return: position_type
- *
  */
 static position_type
-calculate_final_position_part_1(parsed_text_type parsed_text)
+combine_positions(position_type a, position_type b)
 {
-    position_type    position;
-    instruction_type instruction;
-    int              i;
+    position_type combined;
+
+    combined.horizontal = a.horizontal + b.horizontal;
+    combined.aim = a.aim + b.aim;
+    combined.depth = a.depth + b.depth + a.aim * b.horizontal;
+
+    return (combined);
+}
+
+/*
+ * split_part_positions
+ *
+ * Get each part's final position from the part 2 position reached from the
+ * origin.
+ *
+ * Argument: position
+ *     Part 2 position reached from the origin.
+ * Argument: part_1
+ *     OUT: Final position for part 1.
+ * Argument: part_2
+ *     OUT: Final position for part 2.
+ *
+ * Return: void
+ */
+static void
+split_part_positions(position_type  position,
+                     position_type *part_1,
+                     position_type *part_2)
+{
+    initialise_position_type(part_1);
+    part_1->horizontal = position.horizontal;
+    part_1->depth = position.aim;
+
+    *part_2 = position;
+}
+
+/*
+ * calculate_final_positions
+ *
+ * Calculate the final position for both parts in a single pass.
+ *
+ * Argument: text
+ *     Text of one "<direction> <distance>" instruction per line.
+ * Argument: len
+ *     Number of bytes in text.
+ * Argument: part_1
+ *     OUT: Final position for part 1.
+ * Argument: part_2
+ *     OUT: Final position for part 2.
+ *
+ * Return: void
+ *
+ */
+static void
+calculate_final_positions(char          *text,
+                          size_t         len,
+                          position_type *part_1,
+                          position_type *part_2)
+{
+    position_type position;
 
     initialise_position_type(&position);
+    apply_commands(text, len, &position, 0, 0, NULL);
 
-    for (i = 0; i < parsed_text.num_lines; i++) {
-        instruction = parse_line_from_instruction(parsed_text.lines[i].line);
-        if (instruction.direction == FORWARD) {
-            position.horizontal += instruction.distance;
-        } else if (instruction.direction == DOWN) {
-            position.depth += instruction.distance;
-        } else if (instruction.direction == UP) {
-            position.depth -= instruction.distance;
-        } else {
-            assert(false);
-        }
-    }
+    split_part_positions(position, part_1, part_2);
+}
+
+/*
+ * reduce_command_chunk
+ *
+ * Thread function finding the delta and number of commands of a chunk.
+ *
+ * Argument: arg
+ *     Pointer to the command_chunk_type for this thread.
+ *
+ * Return: void *
+ */
+static void *
+reduce_command_chunk(void *arg)
+{
+    command_chunk_type *chunk = arg;
+
+    initialise_position_type(&chunk->delta);
+    chunk->num_commands = apply_commands(chunk->text + chunk->start,
+                                         chunk->end - chunk->start,
+                                         &chunk->delta, 0, 0, NULL);
 
-    return (position);
+    return (NULL);
 }
 
 /*
- * calculate_final_position_part_2
+ * sample_command_chunk
  *
- * Parse instructions from lines and calculate the final position.
+ * Thread function re-applying a chunk's commands from its start position to
+ * record its part of the trajectory.
  *
- * Argument: parsed_text
- *     Parsed text from input file.
+ * Argument: arg
+ *     Pointer to the command_chunk_type for this thread.
  *
- * Return: position_type
+ * Return: void *
+ */
+static void *
+sample_command_chunk(void *arg)
+{
+    command_chunk_type *chunk = arg;
+    position_type       position = chunk->start_position;
+
+    apply_commands(chunk->text + chunk->start, chunk->end - chunk->start,
+                   &position, chunk->first_command, chunk->sample_interval,
+                   chunk->trajectory);
+
+    return (NULL);
+}
+
+/*
+ * calculate_final_positions_parallel
  *
+ * Same as calculate_final_positions(), but as a parallel scan. The text is
+ * split at line boundaries into one chunk per thread, each chunk is reduced
+ * to a delta on its own thread, and the deltas are combined in order.
+ *
+ * If a trajectory is wanted, the exclusive prefix of the deltas gives each
+ * chunk's start position, and a second parallel pass re-applies each chunk
+ * from there to record the sampled positions.
+ *
+ * Argument: text
+ *     Text of one "<direction> <distance>" instruction per line. Does not
+ *     need to be null terminated, so can be a mapped file.
+ * Argument: len
+ *     Number of bytes in text.
+ * Argument: num_threads
+ *     Number of threads to use.
+ * Argument: sample_interval
+ *     Record the position after every this many commands. 0 for no
+ *     trajectory.
+ * Argument: trajectory
+ *     OUT: Allocated array of sampled positions, where element i is the part 2
+ *     position after (i + 1) * sample_interval commands. Must be freed by the
+ *     caller. Set to NULL if sample_interval is 0.
+ * Argument: num_samples
+ *     OUT: Number of elements in trajectory.
+ * Argument: part_1
+ *     OUT: Final position for part 1.
+ * Argument: part_2
+ *     OUT: Final position for part 2.
+ *
+ * Return: void
  */
-static position_type
-calculate_final_position_part_2(parsed_text_type parsed_text)
+static void
+calculate_final_positions_parallel(char           *text,
+                                   size_t          len,
+                                   size_t          num_threads,
+                                   size_t          sample_interval,
+                                   position_type **trajectory,
+                                   size_t         *num_samples,
+                                   position_type  *part_1,
+                                   position_type  *part_2)
 {
-    position_type    position;
-    instruction_type instruction;
-    int              i;
+    command_chunk_type *chunks = NULL;
+    position_type       position;
+    size_t              num_commands;
+    size_t              boundary;
+    size_t              i;
+
+    assert(num_threads > 0);
+
+    chunks = malloc_b(num_threads * sizeof(command_chunk_type));
 
+    boundary = 0;
+    for (i = 0; i < num_threads; i++) {
+        chunks[i].text = text;
+        chunks[i].start = boundary;
+        boundary = find_line_boundary(text, len,
+                                      MAX(boundary,
+                                          len * (i + 1) / num_threads));
+        chunks[i].end = boundary;
+    }
+
+    run_threads(chunks, sizeof(command_chunk_type), num_threads,
+                reduce_command_chunk);
+
+    /* Exclusive scan of the deltas gives each chunk's start position */
     initialise_position_type(&position);
+    num_commands = 0;
+    for (i = 0; i < num_threads; i++) {
+        chunks[i].start_position = position;
+        chunks[i].first_command = num_commands;
+        position = combine_positions(position, chunks[i].delta);
+        num_commands += chunks[i].num_commands;
+    }
+    split_part_positions(position, part_1, part_2);
 
-    for (i = 0; i < parsed_text.num_lines; i++) {
-        instruction = parse_line_from_instruction(parsed_text.lines[i].line);
-        if (instruction.direction == FORWARD) {
-            position.horizontal += instruction.distance;
-            position.depth += instruction.distance * position.aim;
-        } else if (instruction.direction == DOWN) {
-            position.aim += instruction.distance;
-        } else if (instruction.direction == UP) {
-            position.aim -= instruction.distance;
-        } else {
-            assert(false);
+    *trajectory = NULL;
+    *num_samples = 0;
+    if (sample_interval > 0) {
+        *num_samples = num_commands / sample_interval;
+        *trajectory = malloc_b(MAX(1, *num_samples) * sizeof(position_type));
+        for (i = 0; i < num_threads; i++) {
+            chunks[i].sample_interval = sample_interval;
+            chunks[i].trajectory = *trajectory;
         }
+        run_threads(chunks, sizeof(command_chunk_type), num_threads,
+                    sample_command_chunk);
+    }
+
+    free(chunks);
+    chunks = NULL;
+}
+
+/*
+ * report_scaling
+ *
+ * Time the serial and parallel versions on a file, for every thread count
+ * from 1 to the number of online cores, and check they agree.
+ *
+ * Argument: file_name
+ *     File of commands to time on.
+ *
+ * Return: void
+ */
+static void
+report_scaling(char *file_name)
+{
+    char            *text = NULL;
+    size_t           text_len;
+    position_type    expected_1, expected_2;
+    position_type    part_1, part_2;
+    position_type   *trajectory = NULL;
+    size_t           num_samples;
+    size_t           num_threads, max_threads;
+    struct timespec  start_time, end_time;
+    char             description[64];
+
+    text = map_file(file_name, &text_len);
+    max_threads = MAX(1, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%zu bytes, %zu cores\n", text_len, max_threads);
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+    calculate_final_positions(text, text_len, &expected_1, &expected_2);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+    print_elapsed_time(find_elapsed_time_ns(start_time, end_time), "Serial");
+
+    for (num_threads = 1; num_threads <= max_threads; num_threads++) {
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+        calculate_final_positions_parallel(text, text_len, num_threads, 0,
+                                           &trajectory, &num_samples,
+                                           &part_1, &part_2);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+        assert(memcmp(&part_1, &expected_1, sizeof(position_type)) == 0);
+        assert(memcmp(&part_2, &expected_2, sizeof(position_type)) == 0);
+        snprintf(description, sizeof(description), "Parallel, %zu threads",
+                 num_threads);
+        print_elapsed_time(find_elapsed_time_ns(start_time, end_time),
+                           description);
+    }
+
+    munmap(text, text_len);
+    text = NULL;
+}
+
+/*
+ * print_trajectory
+ *
+ * Print the part 2 position after every sample_interval commands, using all
+ * online cores.
+ *
+ * Argument: file_name
+ *     File of commands.
+ * Argument: sample_interval
+ *     Print the position after every this many commands.
+ *
+ * Return: void
+ */
+static void
+print_trajectory(char *file_name, size_t sample_interval)
+{
+    char           *text = NULL;
+    size_t          text_len;
+    position_type   part_1, part_2;
+    position_type  *trajectory = NULL;
+    size_t          num_samples;
+    size_t          i;
+
+    assert(sample_interval > 0);
+
+    text = map_file(file_name, &text_len);
+    calculate_final_positions_parallel(text, text_len,
+                                       MAX(1, sysconf(_SC_NPROCESSORS_ONLN)),
+                                       sample_interval, &trajectory,
+                                       &num_samples, &part_1, &part_2);
+
+    for (i = 0; i < num_samples; i++) {
+        printf("Command %zu: Horizontal = %" PRId64 ", Depth = %" PRId64 ", "
+               "Aim = %" PRId64 "\n",
+               (i + 1) * sample_interval, trajectory[i].horizontal,
+               trajectory[i].depth, trajectory[i].aim);
     }
 
-    return (position);
+    free(trajectory);
+    trajectory = NULL;
+    munmap(text, text_len);
+    text = NULL;
 }
 
 /*
@@ -197,38 +523,53 @@ calculate_final_position_part_2(parsed_text_type parsed_text)
 static void
 runner(char *file_name, bool print_output)
 {
-    parsed_text_type  parsed_text;
-    position_type     final_position;
-
-    parsed_text = parse_file(file_name);
+    char          *text = NULL;
+    size_t         text_len;
+    position_type  part_1, part_2;
 
-    final_position = calculate_final_position_part_1(parsed_text);
-    if (print_output) {
-        printf("Part 1: Horizontal = %d, Depth = %d, H*D = %d\n",
-               final_position.horizontal,
-               final_position.depth,
-               final_position.horizontal * final_position.depth);
-    }
+    text = read_file_to_buffer(file_name, &text_len);
 
-    final_position = calculate_final_position_part_2(parsed_text);
+    calculate_final_positions(text, text_len, &part_1, &part_2);
     if (print_output) {
-        printf("Part 2: Horizontal = %d, Depth = %d, H*D = %d\n",
-               final_position.horizontal,
-               final_position.depth,
-               final_position.horizontal * final_position.depth);
+        printf("Part 1: Horizontal = %" PRId64 ", Depth = %" PRId64 ", "
+               "H*D = %" PRId64 "\n",
+               part_1.horizontal, part_1.depth,
+               part_1.horizontal * part_1.depth);
+        printf("Part 2: Horizontal = %" PRId64 ", Depth = %" PRId64 ", "
+               "H*D = %" PRId64 "\n",
+               part_2.horizontal, part_2.depth,
+               part_2.horizontal * part_2.depth);
     }
 
-    free_parsed_text(parsed_text);
+    free(text);
+    text = NULL;
 }
 
 /*
  * Main function.
+ *
+ * Usage:
+ *   day_02 <file>
+ *       Solve both parts.
+ *   day_02 --scaling <file>
+ *       Time the serial and parallel versions for 1 to all cores.
+ *   day_02 --trajectory <file> <sample_interval>
+ *       Print the position after every sample_interval commands.
  */
 int
 main(int argc, char **argv)
 {
     char *file_name = NULL;
 
+    if (argc == 3 && STRS_EQUAL(argv[1], "--scaling")) {
+        report_scaling(argv[2]);
+        return (0);
+    }
+    if (argc == 4 && STRS_EQUAL(argv[1], "--trajectory")) {
+        print_trajectory(argv[2], strtoul(argv[3], NULL, 10));
+        return (0);
+    }
+
     assert(argc == 2);
     file_name = argv[1];
 
@@ -2,383 +2,465 @@
  * AoC 2021 Day 3 solution
  */
 
+#include <immintrin.h>
+
 #include "utils.h"
 
+/* Bits per word of a bit-sliced column */
+#define BITS_PER_WORD 64
+
+/* Number of words popcounted at once by the AVX2 path */
+#define AVX2_WORDS_PER_VECTOR 4
+
 /*
- * find_most_significant_bit
+ * Widest diagnostic whose rates are printed in decimal. Wider ones are printed
+ * in binary.
+ */
+#define MAX_DECIMAL_RATE_WIDTH 32
+
+/*
+ * diagnostic_columns_type
  *
- * Find the most significant set bit in the number, where bit 0 is the 0/1
- * binary value.
+ * Bit-sliced (transposed) diagnostic report. Each column is stored as its own
+ * bit array across all numbers, so a column's count of 1s is a popcount over
+ * contiguous words, and numbers can be any width.
  *
- * Argument: num
- *     Number to find highest set bit of.
+ * Element: planes
+ *     Array of width * num_words words. Bit j of word w of column c is the
+ *     bit of significance c of number w * BITS_PER_WORD + j.
+ * Element: width
+ *     Number of bits (columns) in each number.
+ * Element: num_numbers
+ *     Number of numbers in the report.
+ * Element: num_words
+ *     Number of words in each column.
+ */
+typedef struct Diagnostic_Columns {
+    uint64_t *planes;
+    size_t    width;
+    size_t    num_numbers;
+    size_t    num_words;
+} diagnostic_columns_type;
+
+/*
+ * bit_criteria_enum_type
  *
- * Return: size_t
+ * Which child to follow at each bit when walking the trie for a rating.
+ *
+ * Element: KEEP_MOST_COMMON
+ *     Keep the most common bit, 1 if equal (oxygen generator rating).
+ * Element: KEEP_LEAST_COMMON
+ *     Keep the least common bit, 0 if equal (CO2 scrubber rating).
  */
-static size_t
-find_most_significant_bit(int num)
-{
-    size_t most_sig_bit = 0;
+typedef enum Bit_Criteria_Enum {
+    KEEP_MOST_COMMON,
+    KEEP_LEAST_COMMON,
+} bit_criteria_enum_type;
 
-    while (num > 1) {
-        num = num >> 1;
-        most_sig_bit++;
-    }
+/*
+ * diagnostic_trie_node_type
+ *
+ * Node of a counted binary trie.
+ *
+ * Element: children
+ *     Index into the trie's node array of the 0 and 1 child, or 0 if there is
+ *     no such child (the root is never a child).
+ * Element: count
+ *     Number of numbers whose prefix ends at this node.
+ */
+typedef struct Diagnostic_Trie_Node {
+    uint32_t children[2];
+    uint32_t count;
+} diagnostic_trie_node_type;
 
-    return (most_sig_bit);
-}
+/*
+ * diagnostic_trie_type
+ *
+ * Counted binary trie of every number in the report, most significant bit
+ * first. Built once, after which any bit criteria rating is a single walk
+ * from the root of at most width steps.
+ *
+ * Element: nodes
+ *     Array of nodes, with the root at index 0.
+ * Element: num_nodes
+ *     Number of nodes in use.
+ * Element: width
+ *     Number of bits in each number, which is the depth of the trie.
+ */
+typedef struct Diagnostic_Trie {
+    diagnostic_trie_node_type *nodes;
+    size_t                     num_nodes;
+    size_t                     width;
+} diagnostic_trie_type;
 
 /*
- * find_most_significant_bit_from_array
+ * make_diagnostic_columns
  *
- * Find the most significant set bit for any number in the given array, where
- * bit 0 is the 0/1 binary value.
+ * Transpose lines of binary numbers into bit-sliced columns. The width is
+ * taken from the first line. The returned struct must be freed with
+ * free_diagnostic_columns().
  *
- * Argument: numbers_array
- *     Array of integers.
- * Argument: len
- *     Length of numbers_array.
+ * Argument: parsed_text
+ *     Parsed text struct, where each line is a binary number.
  *
- * Return: size_t
+ * Return: diagnostic_columns_type
  */
-static size_t
-find_most_significant_bit_from_array(int *numbers_array, size_t len)
+static diagnostic_columns_type
+make_diagnostic_columns(parsed_text_type parsed_text)
 {
-    size_t most_sig_bit;
-    size_t i;
-    int    tmp;
-
-    tmp = 0;
-    for (i = 0; i < len; i++) {
-        tmp |= numbers_array[i];
+    diagnostic_columns_type  columns;
+    char                    *line = NULL;
+    uint64_t                 bit;
+    size_t                   word;
+    size_t                   i, c;
+
+    assert(parsed_text.num_lines > 0);
+
+    columns.width = parsed_text.lines[0].len;
+    columns.num_numbers = parsed_text.num_lines;
+    columns.num_words = (columns.num_numbers + BITS_PER_WORD - 1)
+                        / BITS_PER_WORD;
+    columns.planes = calloc_b(columns.width * columns.num_words,
+                              sizeof(uint64_t));
+
+    for (i = 0; i < parsed_text.num_lines; i++) {
+        line = parsed_text.lines[i].line;
+        assert(parsed_text.lines[i].len == columns.width);
+        word = i / BITS_PER_WORD;
+        bit = (uint64_t) 1 << (i % BITS_PER_WORD);
+        for (c = 0; c < columns.width; c++) {
+            if (line[c] == '1') {
+                /* First character is the most significant column */
+                columns.planes[(columns.width - 1 - c) * columns.num_words
+                               + word] |= bit;
+            }
+        }
     }
-    most_sig_bit = find_most_significant_bit(tmp);
 
-    return (most_sig_bit);
+    return (columns);
+}
+
+/*
+ * free_diagnostic_columns
+ *
+ * Free allocated memory from the diagnostic_columns struct.
+ *
+ * Argument: columns
+ *     diagnostic_columns_type struct to free.
+ *
+ * Return: void
+ */
+static void
+free_diagnostic_columns(diagnostic_columns_type *columns)
+{
+    free(columns->planes);
+    columns->planes = NULL;
 }
 
 /*
- * invert_bits_in_number_up_to_max_bit
+ * popcount_words_scalar
  *
- * For the given number, invert the bits of it up to the most significant
- * max_bit in the number, where bit 0 is the 0/1 binary value.
+ * Count the set bits in an array of words, one word at a time.
  *
- * Argument: num
- *     Number to invert.
- * Argument: max_bit
- *     Highest most significant bit to invert. All higher bits will be 0.
+ * Argument: words
+ *     Array of words.
+ * Argument: num_words
+ *     Number of elements in words.
  *
  * Return: size_t
  */
 static size_t
-invert_bits_in_number_up_to_max_bit(int num, size_t max_bit)
+popcount_words_scalar(uint64_t *words, size_t num_words)
 {
-    int mask;
+    size_t count = 0;
+    size_t i;
 
-    mask = (1 << (max_bit + 1)) - 1;
+    for (i = 0; i < num_words; i++) {
+        count += __builtin_popcountll(words[i]);
+    }
 
-    return ~num & mask;
+    return (count);
 }
 
 /*
- * find_most_common_least_significant_bit
- *
- * For an array of integers, find the most common least significant `n` bit.
- *
- * Argument: numbers_array
- *     Array of integers.
- * Argument: len
- *     Length of numbers_array.
- * Argument: n
- *     The least significant bit to check for the most common value, where bit
- *     0 is the 0/1 binary value.
- * Argument: choose_if_equal
- *     Value to choose if there is an equal number of 1s and 0s. Must be 0 or
- *     1.
- *
- * Return: int
+ * popcount_words_avx2
+ *
+ * Count the set bits in an array of words AVX2_WORDS_PER_VECTOR words at a
+ * time, looking up the count of each nibble with a byte shuffle and summing
+ * the bytes with SAD.
+ *
+ * Argument: words
+ *     Array of words.
+ * Argument: num_words
+ *     Number of elements in words.
+ *
+ * Return: size_t
  */
-static int
-find_most_common_least_significant_bit(int    *numbers_array,
-                                       size_t  len,
-                                       size_t  n,
-                                       int     choose_if_equal)
+__attribute__((target("avx2")))
+static size_t
+popcount_words_avx2(uint64_t *words, size_t num_words)
 {
-    int    most_common;
-    int    num_ones;
-    size_t i;
-
-    assert(choose_if_equal == 0 || choose_if_equal == 1);
-
-    /*
-     * Bit shift the number to get the nth least significant bit as the first
-     * least significant bit, then AND with 1. This returns 1 if the bit was a
-     * one and 0 if a 0. We find the total number of 1s here.
-     */
-    num_ones = 0;
-    for (i = 0; i < len; i++) {
-        num_ones += (numbers_array[i] >> n ) & 1;
+    __m256i  nibble_counts = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+                                              1, 2, 2, 3, 2, 3, 3, 4,
+                                              0, 1, 1, 2, 1, 2, 2, 3,
+                                              1, 2, 2, 3, 2, 3, 3, 4);
+    __m256i  low_mask = _mm256_set1_epi8(0x0f);
+    __m256i  total = _mm256_setzero_si256();
+    __m256i  v, byte_counts;
+    uint64_t lanes[AVX2_WORDS_PER_VECTOR];
+    size_t   count;
+    size_t   i;
+
+    for (i = 0; i + AVX2_WORDS_PER_VECTOR <= num_words;
+         i += AVX2_WORDS_PER_VECTOR) {
+        v = _mm256_loadu_si256((__m256i *) &words[i]);
+        byte_counts = _mm256_add_epi8(
+                _mm256_shuffle_epi8(nibble_counts,
+                                    _mm256_and_si256(v, low_mask)),
+                _mm256_shuffle_epi8(nibble_counts,
+                                    _mm256_and_si256(_mm256_srli_epi16(v, 4),
+                                                     low_mask)));
+        total = _mm256_add_epi64(total,
+                                 _mm256_sad_epu8(byte_counts,
+                                                 _mm256_setzero_si256()));
     }
 
-    /*
-     * If the total number of 1s is > half the total number of numbers in the
-     * array, then 1 is the most common bit, else 0.
-     */
-    if (num_ones * 2 > len) {
-        most_common = 1;
-    } else if (num_ones * 2 < len) {
-        most_common = 0;
-    } else {
-        // Equal number of 1s and 0s.
-        most_common = choose_if_equal;
-    }
+    _mm256_storeu_si256((__m256i *) lanes, total);
+    count = lanes[0] + lanes[1] + lanes[2] + lanes[3];
 
-    return (most_common);
+    return (count + popcount_words_scalar(&words[i], num_words - i));
 }
 
 /*
- * filter_numbers_array_on_matching_bit
+ * find_column_counts
  *
- * Filter the numbers array
+ * Count the number of 1s in every column. Uses AVX2 if the CPU supports it.
  *
- * Argument: numbers_array
- *     Array of integers. This will be modified by this function, the out
- *     pointer will point to the filtered array.
- * Argument: len
- *     Length of numbers_array. This will be modified by this function, the out
- *     pointer will point to the filtered array length.
- * Argument: bit_position
- *     The bit position to consider.
- * Argument: value_to_filter
- *     0 or 1 to filter on.
+ * Argument: columns
+ *     Bit-sliced diagnostic report.
+ * Argument: counts
+ *     OUT: Array of width elements to write the count of each column into,
+ *     indexed by significance.
  *
  * Return: void
  */
 static void
-filter_numbers_array_on_matching_bit(int    **numbers_array,
-                                     size_t  *len,
-                                     size_t   bit_position,
-                                     size_t   value_to_filter)
+find_column_counts(diagnostic_columns_type columns, size_t *counts)
 {
-    size_t  i, j;
-    int     mask;
-    int    *filtered_array = NULL;
-    size_t  filtered_array_len;
-
-    assert(value_to_filter == 0 || value_to_filter == 1);
-
-    mask = 1 << bit_position;
-
-    /*
-     * Find the number of matching numbers in the array and allocate the
-     * required space for them.
-     */
-    filtered_array_len = 0;
-    for (i = 0; i < *len; i++) {
-        if (value_to_filter == 0 && ~(*numbers_array)[i] & mask) {
-            filtered_array_len++;
-        } else if (value_to_filter == 1 && (*numbers_array)[i] & mask) {
-            filtered_array_len++;
-        }
-    }
-
-    filtered_array = malloc_b(sizeof(filtered_array) * filtered_array_len);
-
-    /*
-     * Add the matching numbers to the new array.
-     */
-    for (i = 0, j = 0; i < *len; i++) {
-        if (value_to_filter == 0 && ~(*numbers_array)[i] & mask) {
-            filtered_array[j++] = (*numbers_array)[i];
-        } else if (value_to_filter == 1 && (*numbers_array)[i] & mask) {
-            filtered_array[j++] = (*numbers_array)[i];
+    bool   use_avx2;
+    size_t c;
+
+    use_avx2 = __builtin_cpu_supports("avx2");
+    for (c = 0; c < columns.width; c++) {
+        if (use_avx2) {
+            counts[c] = popcount_words_avx2(
+                                   &columns.planes[c * columns.num_words],
+                                   columns.num_words);
+        } else {
+            counts[c] = popcount_words_scalar(
+                                   &columns.planes[c * columns.num_words],
+                                   columns.num_words);
         }
     }
-
-    /*
-     * Free the old array and set the out pointers.
-     */
-    free(*numbers_array);
-    *numbers_array = filtered_array;
-    *len = filtered_array_len;
 }
 
 /*
- * find_gamma_rate
+ * find_gamma_and_epsilon_rates
  *
- * Find the gamma rate from the numbers array. To calculate this, for each bit
- * in each number in the array, find the most common bit. This most common bit
- * forms the same-significance bit in the gamma rate number.
+ * Find the gamma and epsilon rates from the column counts. Each bit of gamma
+ * is the most common bit of that column (0 if equal), and epsilon is gamma
+ * with every bit up to the width flipped.
  *
- * Argument: numbers_array
- *     Array of integers.
- * Argument: len
- *     Length of numbers_array.
- * Argument: most_sig_bit
- *     The maximum bit to consider, all higher bits will be 0.
+ * Argument: columns
+ *     Bit-sliced diagnostic report.
+ * Argument: counts
+ *     Count of 1s in each column, from find_column_counts().
+ * Argument: gamma_rate
+ *     OUT: Array of ceil(width / BITS_PER_WORD) words to write gamma into,
+ *     least significant word first.
+ * Argument: epsilon_rate
+ *     OUT: Array of ceil(width / BITS_PER_WORD) words to write epsilon into,
+ *     least significant word first.
  *
- * Return: int
+ * Return: void
  */
-static int
-find_gamma_rate(int *numbers_array, size_t len, size_t most_sig_bit)
+static void
+find_gamma_and_epsilon_rates(diagnostic_columns_type  columns,
+                             size_t                  *counts,
+                             uint64_t                *gamma_rate,
+                             uint64_t                *epsilon_rate)
 {
-    size_t most_common_sig_bit;
-    int    current_bit;
-    int    final_num;
-
-    /*
-     * Find the most common bit for each bit, starting from the most
-     * significant.
-     */
-    final_num = 0;
-    for (current_bit = most_sig_bit; current_bit >= 0; current_bit--) {
-        most_common_sig_bit = find_most_common_least_significant_bit(
-                                                                numbers_array,
-                                                                len,
-                                                                current_bit,
-                                                                0);
-        final_num = final_num << 1;
-        final_num += most_common_sig_bit;
+    uint64_t bit;
+    size_t   c;
+
+    memset(gamma_rate, 0, ((columns.width + BITS_PER_WORD - 1)
+                           / BITS_PER_WORD) * sizeof(uint64_t));
+    memset(epsilon_rate, 0, ((columns.width + BITS_PER_WORD - 1)
+                             / BITS_PER_WORD) * sizeof(uint64_t));
+
+    for (c = 0; c < columns.width; c++) {
+        bit = (uint64_t) 1 << (c % BITS_PER_WORD);
+        if (counts[c] * 2 > columns.num_numbers) {
+            gamma_rate[c / BITS_PER_WORD] |= bit;
+        } else {
+            epsilon_rate[c / BITS_PER_WORD] |= bit;
+        }
     }
-
-    return (final_num);
 }
 
 /*
- * find_epsilon_rate
+ * print_rate_in_binary
  *
- * Find the epsilon rate rating from the numbers array. This can be calculated
- * from the gamma rate by flipping all the bits in the number up to a maximum
- * bit position.
+ * Print a rate of any width as a binary string.
  *
- * Argument: gamma_rate
- *     Gamma rate calculated from an array of numbers.
- * Argument: most_sig_bit
- *     The maximum bit to consider which was set in a number frpm the array of
- *     numbers that was used to calculate the gamma rate..
+ * Argument: rate
+ *     Array of words, least significant word first.
+ * Argument: width
+ *     Number of bits to print.
  *
- * Return: int
+ * Return: void
  */
-static int
-find_epsilon_rate(int gamma_rate, size_t most_sig_bit)
+static void
+print_rate_in_binary(uint64_t *rate, size_t width)
 {
-    int    epsilon_rate;
+    size_t c;
 
-    epsilon_rate = invert_bits_in_number_up_to_max_bit(gamma_rate,
-                                                       most_sig_bit);
-
-    return (epsilon_rate);
+    printf("0b");
+    for (c = width; c > 0; c--) {
+        printf("%d", (int) ((rate[(c - 1) / BITS_PER_WORD]
+                             >> ((c - 1) % BITS_PER_WORD)) & 1));
+    }
 }
 
 /*
- * find_oxygen_rating
- *
- * Find the oxygen rating from the numbers array. To calculate this:
- *   - Determine the most common value in the most_sig_bit bit position
- *   - Filter the numbers_array to only those with this most common value
- *   - Repeat the first step with the next most significant bit position and
- *     so on, until only one number remains, which is the oxygen rating
- *
- * Argument: numbers_array
- *     Array of integers.
- * Argument: len
- *     Length of numbers_array.
- * Argument: most_sig_bit
- *     The maximum bit to consider, all higher bits are considered to be 0.
- *
- * Return: int
+ * make_diagnostic_trie
+ *
+ * Build a counted binary trie from lines of binary numbers. All nodes are
+ * allocated up front, so building and querying never allocate. The returned
+ * struct must be freed with free_diagnostic_trie().
+ *
+ * Argument: parsed_text
+ *     Parsed text struct, where each line is a binary number.
+ *
+ * Return: diagnostic_trie_type
  */
-static int
-find_oxygen_rating(int *numbers_array, size_t len, size_t most_sig_bit)
+static diagnostic_trie_type
+make_diagnostic_trie(parsed_text_type parsed_text)
 {
-    int    *filtered_array = NULL;
-    size_t  current_bit;
-    int     oxygen_rating;
-
-    filtered_array = malloc_b(sizeof(int) * len);
-    memcpy(filtered_array, numbers_array, sizeof(int) * len);
-
-    current_bit = most_sig_bit;
-    while (len > 1) {
-        filter_numbers_array_on_matching_bit(
-                                        &filtered_array,
-                                        &len,
-                                        current_bit,
-                                        find_most_common_least_significant_bit(
-                                                                filtered_array,
-                                                                len,
-                                                                current_bit,
-                                                                1));
-        if (current_bit == 0) {
-            // We have used all bits, can only be one entry remaining.
-            assert(len == 1);
-        } else {
-            current_bit--;
+    diagnostic_trie_type  trie;
+    char                 *line = NULL;
+    uint32_t              node;
+    int                   bit;
+    size_t                i, c;
+
+    assert(parsed_text.num_lines > 0);
+
+    trie.width = parsed_text.lines[0].len;
+    /* Each number adds at most one node per bit, plus the root */
+    assert(parsed_text.num_lines * trie.width < UINT32_MAX);
+    trie.nodes = malloc_b((parsed_text.num_lines * trie.width + 1)
+                          * sizeof(diagnostic_trie_node_type));
+    memset(&trie.nodes[0], 0, sizeof(diagnostic_trie_node_type));
+    trie.num_nodes = 1;
+
+    for (i = 0; i < parsed_text.num_lines; i++) {
+        line = parsed_text.lines[i].line;
+        assert(parsed_text.lines[i].len == trie.width);
+        node = 0;
+        trie.nodes[node].count++;
+        for (c = 0; c < trie.width; c++) {
+            bit = (line[c] == '1');
+            if (trie.nodes[node].children[bit] == 0) {
+                trie.nodes[node].children[bit] = trie.num_nodes;
+                memset(&trie.nodes[trie.num_nodes], 0,
+                       sizeof(diagnostic_trie_node_type));
+                trie.num_nodes++;
+            }
+            node = trie.nodes[node].children[bit];
+            trie.nodes[node].count++;
         }
     }
-    oxygen_rating = filtered_array[0];
 
-    free(filtered_array);
+    return (trie);
+}
 
-    return oxygen_rating;
+/*
+ * free_diagnostic_trie
+ *
+ * Free allocated memory from the diagnostic_trie struct.
+ *
+ * Argument: trie
+ *     diagnostic_trie_type struct to free.
+ *
+ * Return: void
+ */
+static void
+free_diagnostic_trie(diagnostic_trie_type *trie)
+{
+    free(trie->nodes);
+    trie->nodes = NULL;
 }
 
 /*
- * find_C02_rating
- *
- * Find the C02 rating from the numbers array. To calculate this:
- *   - Determine the least common value in the most_sig_bit bit position
- *   - Filter the numbers_array to only those with this least common value
- *   - Repeat the first step with the next most significant bit position and
- *     so on, until only one number remains, which is the C02 rating
- *
- * Argument: numbers_array
- *     Array of integers.
- * Argument: len
- *     Length of numbers_array.
- * Argument: most_sig_bit
- *     The maximum bit to consider, all higher bits are considered to be 0.
- *
- * Return: int
+ * find_rating_from_trie
+ *
+ * Find a rating by keeping only the numbers which match the bit criteria at
+ * each bit, most significant first, until one number remains. This is a walk
+ * down the trie choosing a child by the counts at each node. Once only one
+ * number remains there is only one child to follow.
+ *
+ * Argument: trie
+ *     Counted binary trie of the report.
+ * Argument: criteria
+ *     Which bit to keep at each position.
+ * Argument: rating
+ *     OUT: Array of ceil(width / BITS_PER_WORD) words to write the rating
+ *     into, least significant word first.
+ *
+ * Return: void
  */
-static int
-find_C02_rating(int *numbers_array, size_t len, size_t most_sig_bit)
+static void
+find_rating_from_trie(diagnostic_trie_type    trie,
+                      bit_criteria_enum_type  criteria,
+                      uint64_t               *rating)
 {
-    int    *filtered_array = NULL;
-    int     most_common_val;
-    size_t  current_bit;
-    int     c02_rating;
-
-    filtered_array = malloc_b(sizeof(int) * len);
-    memcpy(filtered_array, numbers_array, sizeof(int) * len);
-
-    current_bit = most_sig_bit;
-    while (len > 1) {
-        most_common_val = find_most_common_least_significant_bit(
-                                                                filtered_array,
-                                                                len,
-                                                                current_bit,
-                                                                1);
-        filter_numbers_array_on_matching_bit(
-                      &filtered_array,
-                      &len,
-                      current_bit,
-                      invert_bits_in_number_up_to_max_bit(most_common_val, 0));
-        if (current_bit == 0) {
-            // We have used all bits, can only be one entry remaining.
-            assert(len == 1);
-        } else {
-            current_bit--;
+    uint32_t node;
+    uint32_t num_zeros, num_ones;
+    int      bit;
+    size_t   c;
+
+    memset(rating, 0, ((trie.width + BITS_PER_WORD - 1)
+                       / BITS_PER_WORD) * sizeof(uint64_t));
+
+    node = 0;
+    for (c = trie.width; c > 0; c--) {
+        num_zeros = 0;
+        num_ones = 0;
+        if (trie.nodes[node].children[0] != 0) {
+            num_zeros = trie.nodes[trie.nodes[node].children[0]].count;
+        }
+        if (trie.nodes[node].children[1] != 0) {
+            num_ones = trie.nodes[trie.nodes[node].children[1]].count;
         }
-    }
-    c02_rating = filtered_array[0];
 
-    free(filtered_array);
+        if (num_zeros == 0) {
+            bit = 1;
+        } else if (num_ones == 0) {
+            bit = 0;
+        } else if (criteria == KEEP_MOST_COMMON) {
+            bit = (num_ones >= num_zeros);
+        } else {
+            bit = (num_ones < num_zeros);
+        }
 
-    return c02_rating;
+        if (bit) {
+            rating[(c - 1) / BITS_PER_WORD] |=
+                                      (uint64_t) 1 << ((c - 1) % BITS_PER_WORD);
+        }
+        node = trie.nodes[node].children[bit];
+    }
 }
 
-
 /*
  * runner
  *
@@ -395,45 +477,75 @@ find_C02_rating(int *numbers_array, size_t len, size_t most_sig_bit)
 static void
 runner(char *file_name, bool print_output)
 {
-    parsed_text_type  parsed_text;
-    int              *numbers_array = NULL;
-    size_t            most_sig_bit;
-    int               gamma_rate;
-    int               epsilon_rate;
-    int               oxygen_rating;
-    int               c02_rating;
+    parsed_text_type         parsed_text;
+    diagnostic_columns_type  columns;
+    size_t                  *column_counts = NULL;
+    uint64_t                *gamma_rate = NULL;
+    uint64_t                *epsilon_rate = NULL;
+    size_t                   num_rate_words;
+    diagnostic_trie_type     trie;
+    uint64_t                *oxygen_rating = NULL;
+    uint64_t                *c02_rating = NULL;
 
     parsed_text = parse_file(file_name);
 
-    numbers_array = parse_binary_num_text_to_ints(parsed_text);
-    most_sig_bit = find_most_significant_bit_from_array(numbers_array,
-                                                        parsed_text.num_lines);
+    columns = make_diagnostic_columns(parsed_text);
+    column_counts = malloc_b(columns.width * sizeof(size_t));
+    num_rate_words = (columns.width + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    gamma_rate = malloc_b(num_rate_words * sizeof(uint64_t));
+    epsilon_rate = malloc_b(num_rate_words * sizeof(uint64_t));
 
-    gamma_rate = find_gamma_rate(numbers_array,
-                                 parsed_text.num_lines,
-                                 most_sig_bit);
-    epsilon_rate = find_epsilon_rate(gamma_rate, most_sig_bit);
+    find_column_counts(columns, column_counts);
+    find_gamma_and_epsilon_rates(columns, column_counts, gamma_rate,
+                                 epsilon_rate);
     if (print_output) {
-        printf("Part 1: Gamma = %d, Epsilon = %d, G*E = %d\n",
-               gamma_rate,
-               epsilon_rate,
-               gamma_rate * epsilon_rate);
+        if (columns.width <= MAX_DECIMAL_RATE_WIDTH) {
+            printf("Part 1: Gamma = %zu, Epsilon = %zu, G*E = %zu\n",
+                   (size_t) gamma_rate[0],
+                   (size_t) epsilon_rate[0],
+                   (size_t) (gamma_rate[0] * epsilon_rate[0]));
+        } else {
+            printf("Part 1: Gamma = ");
+            print_rate_in_binary(gamma_rate, columns.width);
+            printf(", Epsilon = ");
+            print_rate_in_binary(epsilon_rate, columns.width);
+            printf("\n");
+        }
     }
 
-    oxygen_rating = find_oxygen_rating(numbers_array,
-                                       parsed_text.num_lines,
-                                       most_sig_bit);
-    c02_rating = find_C02_rating(numbers_array,
-                                 parsed_text.num_lines,
-                                 most_sig_bit);
+    trie = make_diagnostic_trie(parsed_text);
+    oxygen_rating = malloc_b(num_rate_words * sizeof(uint64_t));
+    c02_rating = malloc_b(num_rate_words * sizeof(uint64_t));
+
+    find_rating_from_trie(trie, KEEP_MOST_COMMON, oxygen_rating);
+    find_rating_from_trie(trie, KEEP_LEAST_COMMON, c02_rating);
     if (print_output) {
-        printf("Part 2: Oxygen = %d, C02 = %d, O*C = %d\n",
-               oxygen_rating,
-               c02_rating,
-               oxygen_rating * c02_rating);
+        if (trie.width <= MAX_DECIMAL_RATE_WIDTH) {
+            printf("Part 2: Oxygen = %zu, C02 = %zu, O*C = %zu\n",
+                   (size_t) oxygen_rating[0],
+                   (size_t) c02_rating[0],
+                   (size_t) (oxygen_rating[0] * c02_rating[0]));
+        } else {
+            printf("Part 2: Oxygen = ");
+            print_rate_in_binary(oxygen_rating, trie.width);
+            printf(", C02 = ");
+            print_rate_in_binary(c02_rating, trie.width);
+            printf("\n");
+        }
     }
 
-    free(numbers_array);
+    free(c02_rating);
+    c02_rating = NULL;
+    free(oxygen_rating);
+    oxygen_rating = NULL;
+    free_diagnostic_trie(&trie);
+    free(epsilon_rate);
+    epsilon_rate = NULL;
+    free(gamma_rate);
+    gamma_rate = NULL;
+    free(column_counts);
+    column_counts = NULL;
+    free_diagnostic_columns(&columns);
     free_parsed_text(parsed_text);
 }
 
@@ -2,12 +2,56 @@
  * AoC 2021 Day 4 solution
  */
 
+#include <limits.h>
+#include <unistd.h>
+
 #include "utils.h"
 
 /* Number of lines and columns in the bingo card */
 #define NUM_BINGO_LINES   5
 #define NUM_BINGO_COLUMNS 5
 
+/* Call index of a number which is never called, or a card which never wins */
+#define NEVER_CALLED INT_MAX
+
+/* Fewest cards worth giving a thread of their own when finding wins */
+#define MIN_CARDS_PER_THREAD (1 << 12)
+
+/*
+ * Marked squares of a card are a bitmask with square (line, column) at bit
+ * line * NUM_BINGO_COLUMNS + column. The mask type and the masks of every
+ * line and column are derived from the card size at compile time.
+ */
+#define NUM_BINGO_SQUARES (NUM_BINGO_LINES * NUM_BINGO_COLUMNS)
+
+#if NUM_BINGO_SQUARES <= 32
+typedef uint32_t bingo_mask_type;
+#elif NUM_BINGO_SQUARES <= 64
+typedef uint64_t bingo_mask_type;
+#else
+#error "Bingo cards must have at most 64 squares"
+#endif
+
+/* Mask of the lowest n bits, for n from 1 to the width of the mask type */
+#define BINGO_LOW_BITS_MASK(n) \
+    ((((bingo_mask_type) 1 << ((n) - 1)) << 1) - 1)
+
+#define BINGO_SQUARE_BIT(line, column) \
+    ((bingo_mask_type) 1 << ((line) * NUM_BINGO_COLUMNS + (column)))
+
+#define BINGO_LINE_MASK(line) \
+    (BINGO_LOW_BITS_MASK(NUM_BINGO_COLUMNS) << ((line) * NUM_BINGO_COLUMNS))
+
+/* All squares divided by the first line is 1 in every line's first column */
+#define BINGO_COLUMN_MASK(column) \
+    ((BINGO_LOW_BITS_MASK(NUM_BINGO_SQUARES) / BINGO_LINE_MASK(0)) << (column))
+
+#define IS_BINGO_LINE_COMPLETE(marked, line) \
+    (((marked) & BINGO_LINE_MASK(line)) == BINGO_LINE_MASK(line))
+
+#define IS_BINGO_COLUMN_COMPLETE(marked, column) \
+    (((marked) & BINGO_COLUMN_MASK(column)) == BINGO_COLUMN_MASK(column))
+
 /*
  * bingo_calls_type
  *
@@ -21,31 +65,18 @@ typedef struct Bingo_Calls {
     int  num_calls;
 } bingo_calls_type;
 
-/*
- * bingo_square_type
- *
- * Element: num
- *     The bingo number of this square.
- * Element: called
- *     If this bingo number has been called.
- */
-typedef struct Bingo_Square {
-    int  num;
-    bool called;
-} bingo_square_type;
-
 /*
  * bingo_card_type
  *
+ * The numbers of a card. Which squares have been called is kept separately
+ * per game as a bingo_mask_type, so a card set can be shared by many games.
+ *
  * Element: lines
  *     2D array. First array is of the lines in the bingo card. Second array
  *     is the columns in that particular line.
- * Element: has_line
- *     If this bingo card has a completed line.
  */
 typedef struct Bingo_Card {
-    bingo_square_type lines[NUM_BINGO_LINES][NUM_BINGO_COLUMNS];
-    bool              has_line;
+    int lines[NUM_BINGO_LINES][NUM_BINGO_COLUMNS];
 } bingo_card_type;
 
 /*
@@ -61,6 +92,123 @@ typedef struct Bingo_Cards {
     size_t           num_cards;
 } bingo_cards_type;
 
+/*
+ * bingo_square_ref_type
+ *
+ * Location of a square on a bingo card.
+ *
+ * Element: card
+ *     Index of the card in the bingo cards array.
+ * Element: line
+ *     Line of the square in the card.
+ * Element: column
+ *     Column of the square in the card.
+ */
+typedef struct Bingo_Square_Ref {
+    uint32_t card;
+    uint8_t  line;
+    uint8_t  column;
+} bingo_square_ref_type;
+
+/*
+ * bingo_index_type
+ *
+ * Inverted index from a bingo number to every square it appears in, so a call
+ * only touches the squares containing the called number. The squares for
+ * number n are squares[offsets[n]] up to squares[offsets[n + 1]], in card
+ * order.
+ *
+ * Element: offsets
+ *     Array of num_numbers + 1 offsets into squares.
+ * Element: squares
+ *     Array of square references, grouped by number.
+ * Element: num_numbers
+ *     One more than the largest number on any card.
+ */
+typedef struct Bingo_Index {
+    size_t                *offsets;
+    bingo_square_ref_type *squares;
+    int                    num_numbers;
+} bingo_index_type;
+
+/*
+ * bingo_win_type
+ *
+ * When a card wins and its score at that point.
+ *
+ * Element: card
+ *     Index of the card in the bingo cards array.
+ * Element: call_index
+ *     Index of the call which completes the card's first line, or
+ *     NEVER_CALLED if it never wins.
+ * Element: winning_number
+ *     Number called which completes the card's first line.
+ * Element: card_score
+ *     Sum of the card's numbers not called by then.
+ */
+typedef struct Bingo_Win {
+    size_t card;
+    int    call_index;
+    int    winning_number;
+    int    card_score;
+} bingo_win_type;
+
+/*
+ * bingo_card_chunk_type
+ *
+ * Work for one thread computing the wins of a range of cards.
+ *
+ * Element: bingo_calls
+ *     Bingo calls struct.
+ * Element: bingo_cards
+ *     Array of all bingo_card structs. Only read.
+ * Element: call_indices
+ *     Index of the first call of each number on the cards, or NEVER_CALLED.
+ * Element: start
+ *     Index of the first card in the chunk.
+ * Element: end
+ *     One past the index of the last card in the chunk.
+ * Element: wins
+ *     OUT: Array of wins for all cards, shared by all chunks.
+ */
+typedef struct Bingo_Card_Chunk {
+    bingo_calls_type  bingo_calls;
+    bingo_cards_type  bingo_cards;
+    int              *call_indices;
+    size_t            start;
+    size_t            end;
+    bingo_win_type   *wins;
+} bingo_card_chunk_type;
+
+/*
+ * bingo_batch_chunk_type
+ *
+ * Work for one thread playing a range of call sequences against the shared
+ * cards.
+ *
+ * Element: sequences
+ *     Array of all call sequences.
+ * Element: bingo_cards
+ *     Array of all bingo_card structs. Only read.
+ * Element: index
+ *     Inverted index of the cards. Only read.
+ * Element: start
+ *     Index of the first sequence in the chunk.
+ * Element: end
+ *     One past the index of the last sequence in the chunk.
+ * Element: wins
+ *     OUT: Array of wins for every card of every sequence, with the wins of
+ *     sequence s starting at s * num_cards. Shared by all chunks.
+ */
+typedef struct Bingo_Batch_Chunk {
+    bingo_calls_type *sequences;
+    bingo_cards_type  bingo_cards;
+    bingo_index_type  index;
+    size_t            start;
+    size_t            end;
+    bingo_win_type   *wins;
+} bingo_batch_chunk_type;
+
 /*
  * parse_lines_into_calls_and_cards
  *
@@ -107,7 +255,7 @@ parse_lines_into_calls_and_cards(parsed_text_type   parsed_text,
         }
         // Start of a card, skip over the next NUM_BINGO_LINES-1 lines;
         bingo_cards->num_cards++;
-        current_line += NUM_BINGO_COLUMNS;
+        current_line += NUM_BINGO_LINES;
     }
 
     bingo_cards->cards = malloc_b(
@@ -121,15 +269,13 @@ parse_lines_into_calls_and_cards(parsed_text_type   parsed_text,
             continue;
         }
         // Start of a card, parse the next NUM_BINGO_LINES lines;
-        bingo_cards->cards[current_card].has_line = false;
         for (i = 0; i < NUM_BINGO_LINES; i++) {
             split_text = split_string_on_char(
                                   parsed_text.lines[current_line++].line, ' ');
             parsed_line_ints = parse_text_to_ints(split_text);
             for (j = 0; j< NUM_BINGO_COLUMNS; j++) {
-                bingo_cards->cards[current_card].lines[i][j].num =
+                bingo_cards->cards[current_card].lines[i][j] =
                                                            parsed_line_ints[j];
-                bingo_cards->cards[current_card].lines[i][j].called = false;
             }
             free(parsed_line_ints);
             parsed_line_ints = NULL;
@@ -142,129 +288,109 @@ parse_lines_into_calls_and_cards(parsed_text_type   parsed_text,
 }
 
 /*
- * check_off_bingo_number
+ * find_num_bingo_numbers
  *
- * For the given bingo card, check off any squares matching the called number.
+ * Find one more than the largest number on any of the cards.
  *
- * Argument: bingo_card
- *     Bingo card to check for the called number.
- * Argument: called_num
- *     Number to check off if it is on the bingo card.
+ * Argument: bingo_cards
+ *     Array of bingo_card structs.
  *
- * Return: void
+ * Return: int
  */
-static void
-check_off_bingo_number(bingo_card_type *bingo_card, int called_num)
+static int
+find_num_bingo_numbers(bingo_cards_type bingo_cards)
 {
-    size_t i, j;
+    int    num_numbers = 0;
+    int    num;
+    size_t i, j, k;
 
-    for (i = 0; i < NUM_BINGO_LINES; i++) {
-        for (j = 0; j < NUM_BINGO_COLUMNS; j++) {
-            if (bingo_card->lines[i][j].num == called_num) {
-                bingo_card->lines[i][j].called = true;
+    for (i = 0; i < bingo_cards.num_cards; i++) {
+        for (j = 0; j < NUM_BINGO_LINES; j++) {
+            for (k = 0; k < NUM_BINGO_COLUMNS; k++) {
+                num = bingo_cards.cards[i].lines[j][k];
+                assert(num >= 0);
+                num_numbers = MAX(num_numbers, num + 1);
             }
         }
     }
+
+    return (num_numbers);
 }
 
 /*
- * check_for_winning_line
+ * make_bingo_index
  *
- * Check if any of the given bingo cards have a winning line.
+ * Build the inverted index from bingo number to squares for the given cards.
+ * The returned struct must be freed with free_bingo_index().
  *
  * Argument: bingo_cards
- *     Array of bingo cards to check. The first card in the array which has a
- *     line will be returned.
+ *     Array of bingo_card structs.
  *
- * Return: bingo_card_type *
+ * Return: bingo_index_type
  */
-static bingo_card_type *
-check_for_winning_line(bingo_cards_type bingo_cards)
+static bingo_index_type
+make_bingo_index(bingo_cards_type bingo_cards)
 {
-    bool             has_line;
-    bingo_card_type *first_winner = NULL;
-    size_t           i, j, k;
+    bingo_index_type  index;
+    size_t           *next_square = NULL;
+    int               num;
+    size_t            i, j, k;
+
+    assert(bingo_cards.num_cards < UINT32_MAX);
+
+    index.num_numbers = find_num_bingo_numbers(bingo_cards);
 
+    /* Count the squares for each number, then turn counts into offsets */
+    index.offsets = calloc_b(index.num_numbers + 1, sizeof(size_t));
     for (i = 0; i < bingo_cards.num_cards; i++) {
-        /* Check for horizontal line */
         for (j = 0; j < NUM_BINGO_LINES; j++) {
-            has_line = true;
             for (k = 0; k < NUM_BINGO_COLUMNS; k++) {
-                if (!(bingo_cards.cards[i].lines[j][k].called)) {
-                    has_line = false;
-                }
-            }
-            if (has_line) {
-                bingo_cards.cards[i].has_line = true;
-                if (first_winner == NULL) {
-                    first_winner = &(bingo_cards.cards[i]);
-                }
+                index.offsets[bingo_cards.cards[i].lines[j][k] + 1]++;
             }
         }
-        /* Check for vertical line */
-        if (!(bingo_cards.cards[i].has_line)) {
-            for (j = 0; j < NUM_BINGO_COLUMNS; j++) {
-                has_line = true;
-                for (k = 0; k < NUM_BINGO_LINES; k++) {
-                    if (!(bingo_cards.cards[i].lines[k][j].called)) {
-                        has_line = false;
-                    }
-                }
-                if (has_line) {
-                    bingo_cards.cards[i].has_line = true;
-                    if (first_winner == NULL) {
-                        first_winner = &(bingo_cards.cards[i]);
-                    }
-                }
+    }
+    for (num = 0; num < index.num_numbers; num++) {
+        index.offsets[num + 1] += index.offsets[num];
+    }
+
+    index.squares = malloc_b(index.offsets[index.num_numbers]
+                             * sizeof(bingo_square_ref_type));
+    next_square = malloc_b(index.num_numbers * sizeof(size_t));
+    memcpy(next_square, index.offsets, index.num_numbers * sizeof(size_t));
+    for (i = 0; i < bingo_cards.num_cards; i++) {
+        for (j = 0; j < NUM_BINGO_LINES; j++) {
+            for (k = 0; k < NUM_BINGO_COLUMNS; k++) {
+                num = bingo_cards.cards[i].lines[j][k];
+                index.squares[next_square[num]].card = i;
+                index.squares[next_square[num]].line = j;
+                index.squares[next_square[num]].column = k;
+                next_square[num]++;
             }
         }
     }
 
-    return (first_winner);
+    free(next_square);
+
+    return (index);
 }
 
 /*
- * find_bingo_winner
+ * free_bingo_index
  *
- * Find the first card to win out of the given cards.
+ * Free allocated memory from the bingo_index struct.
  *
- * Argument: bingo_calls
- *     Bingo calls struct.
- * Argument: bingo_cards
- *     Array of bingo_card structs.
- * Argument: bingo_cards
- *     OUT: Number called which caused the first card to win.
+ * Argument: index
+ *     bingo_index_type struct to free.
  *
- * Return: bingo_card_type
+ * Return: void
  */
-static bingo_card_type
-find_bingo_winner(bingo_calls_type  bingo_calls,
-                  bingo_cards_type  bingo_cards,
-                  int              *winning_number)
+static void
+free_bingo_index(bingo_index_type *index)
 {
-    size_t           i, j;
-    bingo_card_type *line_winner = NULL;
-
-    /*
-     * For each bingo call, check off the called number in all the cards and
-     * check for any lines.
-     */
-    for (i = 0; i < bingo_calls.num_calls; i++) {
-        for (j = 0; j < bingo_cards.num_cards; j++) {
-            check_off_bingo_number(&(bingo_cards.cards[j]),
-                                   bingo_calls.calls[i]);
-        }
-        line_winner = check_for_winning_line(bingo_cards);
-        if (line_winner != NULL) {
-            /* Found a line winner */
-            *winning_number = bingo_calls.calls[i];
-            break;
-        }
-    }
-    /* We should find a winner above */
-    assert(line_winner != NULL);
-
-    return (*line_winner);
+    free(index->squares);
+    index->squares = NULL;
+    free(index->offsets);
+    index->offsets = NULL;
 }
 
 /*
@@ -272,21 +398,24 @@ find_bingo_winner(bingo_calls_type  bingo_calls,
  *
  * Calculate the sum of all the unmarked numbers on the bingo card.
  *
- * Argument: bingo_cards
+ * Argument: bingo_card
  *     Bingo card to sum unmarked numbers of.
+ * Argument: marked
+ *     Mask of the squares on the card which have been called.
  *
  * Return: int
  */
 static int
-find_sum_of_unmarked_numbers(bingo_card_type bingo_card)
+find_sum_of_unmarked_numbers(bingo_card_type *bingo_card,
+                             bingo_mask_type  marked)
 {
     size_t i, j;
     int    score = 0;
 
     for (i = 0; i < NUM_BINGO_LINES; i++) {
         for (j = 0; j < NUM_BINGO_COLUMNS; j++) {
-            if (!(bingo_card.lines[i][j].called)) {
-                score += bingo_card.lines[i][j].num;
+            if (!(marked & BINGO_SQUARE_BIT(i, j))) {
+                score += bingo_card->lines[i][j];
             }
         }
     }
@@ -295,107 +424,670 @@ find_sum_of_unmarked_numbers(bingo_card_type bingo_card)
 }
 
 /*
- * filter_cards_to_non_winners
+ * play_bingo_calls
  *
- * Filter a bingo cards array to an array of non-winners only.
+ * Play the calls until every card has a line, and record when each card wins.
+ * Each call marks only the squares in the index for that number, then checks
+ * the marked square's line and column against their masks. Cards stop being
+ * marked once they have won.
  *
+ * Argument: bingo_calls
+ *     Bingo calls struct.
  * Argument: bingo_cards
- *     Array of bingo_card structs.
- * Argument: non_winners
- *     OUT: Array of bingo_card structs which are non-winners. This must be
- *     freed by the caller.
+ *     Array of bingo_card structs. Only read.
+ * Argument: index
+ *     Inverted index of the cards.
+ * Argument: marked
+ *     Array of one mask per card to mark called squares in. Its contents on
+ *     entry are ignored.
+ * Argument: wins
+ *     OUT: Array of one win per card, in card order.
  *
- * Return: bingo_card_type
+ * Return: void
  */
 static void
-filter_cards_to_non_winners(bingo_cards_type  bingo_cards,
-                            bingo_cards_type *non_winners)
+play_bingo_calls(bingo_calls_type  bingo_calls,
+                 bingo_cards_type  bingo_cards,
+                 bingo_index_type  index,
+                 bingo_mask_type  *marked,
+                 bingo_win_type   *wins)
 {
-    size_t i, j;
+    bingo_square_ref_type *square = NULL;
+    bingo_win_type        *win = NULL;
+    size_t                 num_winners;
+    int                    num;
+    size_t                 i, j;
 
-    if (non_winners->cards != NULL) {
-        free(non_winners->cards);
-        non_winners->cards = NULL;
+    memset(marked, 0, bingo_cards.num_cards * sizeof(bingo_mask_type));
+    for (i = 0; i < bingo_cards.num_cards; i++) {
+        wins[i].card = i;
+        wins[i].call_index = NEVER_CALLED;
+        wins[i].winning_number = 0;
+        wins[i].card_score = 0;
     }
 
-    non_winners->num_cards = 0;
-    for (i = 0; i < bingo_cards.num_cards; i++) {
-        if (!(bingo_cards.cards[i].has_line)) {
-            non_winners->num_cards++;
+    num_winners = 0;
+    for (i = 0; i < bingo_calls.num_calls &&
+                num_winners < bingo_cards.num_cards; i++) {
+        num = bingo_calls.calls[i];
+        if (num < 0 || num >= index.num_numbers) {
+            /* Not on any card */
+            continue;
+        }
+        /*
+         * Mark every square of the number before looking for lines, as a
+         * card can hold a number more than once and its score must count
+         * all of them as called.
+         */
+        for (j = index.offsets[num]; j < index.offsets[num + 1]; j++) {
+            square = &(index.squares[j]);
+            if (wins[square->card].call_index == NEVER_CALLED) {
+                marked[square->card] |= BINGO_SQUARE_BIT(square->line,
+                                                         square->column);
+            }
+        }
+        for (j = index.offsets[num]; j < index.offsets[num + 1]; j++) {
+            square = &(index.squares[j]);
+            win = &(wins[square->card]);
+            if (win->call_index != NEVER_CALLED) {
+                continue;
+            }
+            if (IS_BINGO_LINE_COMPLETE(marked[square->card], square->line) ||
+                IS_BINGO_COLUMN_COMPLETE(marked[square->card],
+                                         square->column)) {
+                win->call_index = i;
+                win->winning_number = num;
+                win->card_score = find_sum_of_unmarked_numbers(
+                                          &(bingo_cards.cards[square->card]),
+                                          marked[square->card]);
+                num_winners++;
+            }
+        }
+    }
+}
+
+/*
+ * make_call_indices
+ *
+ * Map each number to the index of the first call of it.
+ *
+ * Argument: bingo_calls
+ *     Bingo calls struct.
+ * Argument: num_numbers
+ *     One more than the largest number of interest. Larger calls are ignored.
+ *
+ * Return: int *
+ *     Array of num_numbers call indices, with NEVER_CALLED for numbers which
+ *     are not called. Must be freed by the caller.
+ */
+static int *
+make_call_indices(bingo_calls_type bingo_calls, int num_numbers)
+{
+    int *call_indices = NULL;
+    int  num;
+    int  i;
+
+    call_indices = malloc_b(num_numbers * sizeof(int));
+    for (num = 0; num < num_numbers; num++) {
+        call_indices[num] = NEVER_CALLED;
+    }
+    for (i = bingo_calls.num_calls - 1; i >= 0; i--) {
+        num = bingo_calls.calls[i];
+        if (num >= 0 && num < num_numbers) {
+            call_indices[num] = i;
+        }
+    }
+
+    return (call_indices);
+}
+
+/*
+ * find_card_win
+ *
+ * Find when a card wins without playing the calls. A line is complete at the
+ * latest call of any of its numbers, and the card wins at the earliest
+ * complete line or column.
+ *
+ * Argument: bingo_calls
+ *     Bingo calls struct.
+ * Argument: bingo_card
+ *     Bingo card to find the win of.
+ * Argument: call_indices
+ *     Index of the first call of each number, from make_call_indices().
+ * Argument: card
+ *     Index of the card, to store in the win.
+ *
+ * Return: bingo_win_type
+ */
+static bingo_win_type
+find_card_win(bingo_calls_type  bingo_calls,
+              bingo_card_type  *bingo_card,
+              int              *call_indices,
+              size_t            card)
+{
+    bingo_win_type win;
+    int            square_calls[NUM_BINGO_LINES][NUM_BINGO_COLUMNS];
+    int            line_call;
+    size_t         i, j;
+
+    for (i = 0; i < NUM_BINGO_LINES; i++) {
+        for (j = 0; j < NUM_BINGO_COLUMNS; j++) {
+            square_calls[i][j] = call_indices[bingo_card->lines[i][j]];
         }
     }
 
-    non_winners->cards = malloc_b(
-                             non_winners->num_cards * sizeof(bingo_card_type));
+    win.card = card;
+    win.call_index = NEVER_CALLED;
+    for (i = 0; i < NUM_BINGO_LINES; i++) {
+        line_call = 0;
+        for (j = 0; j < NUM_BINGO_COLUMNS; j++) {
+            line_call = MAX(line_call, square_calls[i][j]);
+        }
+        win.call_index = MIN(win.call_index, line_call);
+    }
+    for (j = 0; j < NUM_BINGO_COLUMNS; j++) {
+        line_call = 0;
+        for (i = 0; i < NUM_BINGO_LINES; i++) {
+            line_call = MAX(line_call, square_calls[i][j]);
+        }
+        win.call_index = MIN(win.call_index, line_call);
+    }
 
-    for (i = 0, j = 0; i < bingo_cards.num_cards; i++) {
-        if (!(bingo_cards.cards[i].has_line)) {
-            non_winners->cards[j++] = bingo_cards.cards[i];
+    win.winning_number = 0;
+    win.card_score = 0;
+    if (win.call_index != NEVER_CALLED) {
+        win.winning_number = bingo_calls.calls[win.call_index];
+        for (i = 0; i < NUM_BINGO_LINES; i++) {
+            for (j = 0; j < NUM_BINGO_COLUMNS; j++) {
+                if (square_calls[i][j] > win.call_index) {
+                    win.card_score += bingo_card->lines[i][j];
+                }
+            }
         }
     }
+
+    return (win);
+}
+
+/*
+ * find_card_wins_chunk
+ *
+ * Thread function to find the wins of a chunk of cards.
+ *
+ * Argument: arg
+ *     bingo_card_chunk_type of the chunk.
+ *
+ * Return: void *
+ */
+static void *
+find_card_wins_chunk(void *arg)
+{
+    bingo_card_chunk_type *chunk = arg;
+    size_t                 i;
+
+    for (i = chunk->start; i < chunk->end; i++) {
+        chunk->wins[i] = find_card_win(chunk->bingo_calls,
+                                       &(chunk->bingo_cards.cards[i]),
+                                       chunk->call_indices,
+                                       i);
+    }
+
+    return (NULL);
 }
 
 /*
- * find_last_winner
+ * find_card_wins_parallel
  *
- * Find the card which wins last out of the given cards.
+ * Find when every card wins and its score, with the cards split evenly across
+ * threads. Each card is independent, so no state is shared between threads
+ * except the read-only call indices.
  *
  * Argument: bingo_calls
  *     Bingo calls struct.
  * Argument: bingo_cards
- *     Array of bingo_card structs.
+ *     Array of bingo_card structs. Only read.
+ * Argument: num_threads
+ *     Number of threads to use.
+ * Argument: wins
+ *     OUT: Array of one win per card, in card order.
+ *
+ * Return: void
+ */
+static void
+find_card_wins_parallel(bingo_calls_type  bingo_calls,
+                        bingo_cards_type  bingo_cards,
+                        size_t            num_threads,
+                        bingo_win_type   *wins)
+{
+    bingo_card_chunk_type *chunks = NULL;
+    int                   *call_indices = NULL;
+    int                    num_numbers;
+    size_t                 i;
+
+    assert(num_threads > 0);
+
+    num_numbers = find_num_bingo_numbers(bingo_cards);
+    call_indices = make_call_indices(bingo_calls, num_numbers);
+
+    chunks = malloc_b(num_threads * sizeof(bingo_card_chunk_type));
+    for (i = 0; i < num_threads; i++) {
+        chunks[i].bingo_calls = bingo_calls;
+        chunks[i].bingo_cards = bingo_cards;
+        chunks[i].call_indices = call_indices;
+        chunks[i].start = bingo_cards.num_cards * i / num_threads;
+        chunks[i].end = bingo_cards.num_cards * (i + 1) / num_threads;
+        chunks[i].wins = wins;
+    }
+    run_threads(chunks, sizeof(bingo_card_chunk_type), num_threads,
+                find_card_wins_chunk);
+
+    free(chunks);
+    chunks = NULL;
+    free(call_indices);
+    call_indices = NULL;
+}
+
+/*
+ * order_card_wins
+ *
+ * Order the cards by when they win with a counting sort on the call index.
+ * Cards winning on the same call stay in card order, and cards which never
+ * win come last. The nth winner is then wins[order[n - 1]].
+ *
+ * Argument: wins
+ *     Array of one win per card, from find_card_wins_parallel().
+ * Argument: num_cards
+ *     Number of elements in wins.
+ * Argument: num_calls
+ *     Number of calls.
+ * Argument: order
+ *     OUT: Array of num_cards card indices in winning order.
+ *
+ * Return: void
+ */
+static void
+order_card_wins(bingo_win_type *wins,
+                size_t          num_cards,
+                int             num_calls,
+                size_t         *order)
+{
+    size_t *call_offsets = NULL;
+    size_t  bucket;
+    size_t  i;
+
+    /* One bucket per call, plus one for cards which never win */
+    call_offsets = calloc_b(num_calls + 2, sizeof(size_t));
+    for (i = 0; i < num_cards; i++) {
+        bucket = (wins[i].call_index == NEVER_CALLED ? num_calls
+                                                     : wins[i].call_index);
+        call_offsets[bucket + 1]++;
+    }
+    for (i = 0; i < num_calls + 1; i++) {
+        call_offsets[i + 1] += call_offsets[i];
+    }
+    for (i = 0; i < num_cards; i++) {
+        bucket = (wins[i].call_index == NEVER_CALLED ? num_calls
+                                                     : wins[i].call_index);
+        order[call_offsets[bucket]++] = i;
+    }
+
+    free(call_offsets);
+    call_offsets = NULL;
+}
+
+/*
+ * play_bingo_batch_chunk
+ *
+ * Thread function to play a chunk of call sequences. One array of marked masks
+ * is reused for every sequence in the chunk.
+ *
+ * Argument: arg
+ *     bingo_batch_chunk_type of the chunk.
+ *
+ * Return: void *
+ */
+static void *
+play_bingo_batch_chunk(void *arg)
+{
+    bingo_batch_chunk_type *chunk = arg;
+    bingo_mask_type        *marked = NULL;
+    size_t                  i;
+
+    marked = malloc_b(chunk->bingo_cards.num_cards * sizeof(bingo_mask_type));
+    for (i = chunk->start; i < chunk->end; i++) {
+        play_bingo_calls(chunk->sequences[i], chunk->bingo_cards, chunk->index,
+                         marked,
+                         &(chunk->wins[i * chunk->bingo_cards.num_cards]));
+    }
+
+    free(marked);
+    marked = NULL;
+
+    return (NULL);
+}
+
+/*
+ * play_bingo_batch
+ *
+ * Play many call sequences against the same cards, with the sequences split
+ * evenly across threads. The cards and index are shared and only read, and
+ * each thread marks squares in its own masks, so no cards are copied.
+ *
+ * Argument: sequences
+ *     Array of call sequences.
+ * Argument: num_sequences
+ *     Number of elements in sequences.
  * Argument: bingo_cards
- *     OUT: Number called which caused the last card to win.
+ *     Array of bingo_card structs. Only read.
+ * Argument: index
+ *     Inverted index of the cards.
+ * Argument: num_threads
+ *     Number of threads to use.
+ * Argument: wins
+ *     OUT: Array of num_sequences * num_cards wins, with the wins of sequence
+ *     s in card order starting at s * num_cards.
  *
- * Return: bingo_card_type
+ * Return: void
  */
-static bingo_card_type
-find_last_winner(bingo_calls_type  bingo_calls,
+static void
+play_bingo_batch(bingo_calls_type *sequences,
+                 size_t            num_sequences,
                  bingo_cards_type  bingo_cards,
-                 int              *winning_number)
+                 bingo_index_type  index,
+                 size_t            num_threads,
+                 bingo_win_type   *wins)
 {
-    size_t            i, j;
-    bingo_cards_type  non_winners;
-    bingo_cards_type  non_winners_copy;
-    bingo_cards_type  tmp;
-    bingo_card_type  *last_winner = NULL;
-    bingo_card_type  last_winner_ret;
-
-    /* Create copies of original cards */
-    non_winners.cards = NULL;
-    non_winners_copy.cards = NULL;
-    filter_cards_to_non_winners(bingo_cards, &non_winners);
-
-    for (i = 0; i < bingo_calls.num_calls; i++) {
-        /* Create copies of non-winners cards */
-        filter_cards_to_non_winners(non_winners, &non_winners_copy);
-        for (j = 0; j < non_winners.num_cards; j++) {
-            check_off_bingo_number(&(non_winners.cards[j]),
-                                   bingo_calls.calls[i]);
+    bingo_batch_chunk_type *chunks = NULL;
+    size_t                  i;
+
+    assert(num_threads > 0);
+
+    chunks = malloc_b(num_threads * sizeof(bingo_batch_chunk_type));
+    for (i = 0; i < num_threads; i++) {
+        chunks[i].sequences = sequences;
+        chunks[i].bingo_cards = bingo_cards;
+        chunks[i].index = index;
+        chunks[i].start = num_sequences * i / num_threads;
+        chunks[i].end = num_sequences * (i + 1) / num_threads;
+        chunks[i].wins = wins;
+    }
+    run_threads(chunks, sizeof(bingo_batch_chunk_type), num_threads,
+                play_bingo_batch_chunk);
+
+    free(chunks);
+    chunks = NULL;
+}
+
+/*
+ * read_calls_and_cards
+ *
+ * Read and parse a file of bingo calls and cards.
+ *
+ * Argument: file_name
+ *     File to read input from.
+ * Argument: bingo_calls
+ *     OUT: Bingo calls struct. The calls must be freed by the caller.
+ * Argument: bingo_cards
+ *     OUT: Array of bingo_card structs. The cards must be freed by the caller.
+ *
+ * Return: void
+ */
+static void
+read_calls_and_cards(char             *file_name,
+                     bingo_calls_type *bingo_calls,
+                     bingo_cards_type *bingo_cards)
+{
+    parsed_text_type parsed_text;
+
+    parsed_text = parse_file(file_name);
+    parse_lines_into_calls_and_cards(parsed_text, bingo_calls, bingo_cards);
+    free_parsed_text(parsed_text);
+}
+
+/*
+ * read_call_sequences
+ *
+ * Read a file of call sequences, one comma-separated sequence per line.
+ *
+ * Argument: file_name
+ *     File to read call sequences from.
+ * Argument: num_sequences
+ *     OUT: Number of sequences read.
+ *
+ * Return: bingo_calls_type *
+ *     Array of call sequences. Each sequence's calls and the array must be
+ *     freed by the caller.
+ */
+static bingo_calls_type *
+read_call_sequences(char *file_name, size_t *num_sequences)
+{
+    parsed_text_type  parsed_text;
+    parsed_text_type  split_text;
+    bingo_calls_type *sequences = NULL;
+    size_t            i;
+
+    parsed_text = parse_file(file_name);
+    sequences = malloc_b(parsed_text.num_lines * sizeof(bingo_calls_type));
+    *num_sequences = 0;
+    for (i = 0; i < parsed_text.num_lines; i++) {
+        if (IS_EMTPY_STR(parsed_text.lines[i].line)) {
+            continue;
         }
-        check_for_winning_line(non_winners);
-        filter_cards_to_non_winners(non_winners, &non_winners_copy);
-        tmp = non_winners_copy;
-        non_winners_copy = non_winners;
-        non_winners = tmp;
-        if (non_winners.num_cards == 1) {
-            /* All but one card has won */
-            last_winner = &(non_winners.cards[0]);
-        } else if (non_winners.num_cards == 0) {
-            /* All cards have now won */
-            *winning_number = bingo_calls.calls[i];
-            break;
+        split_text = split_string_on_char(parsed_text.lines[i].line, ',');
+        sequences[*num_sequences].calls = parse_text_to_ints(split_text);
+        sequences[*num_sequences].num_calls = split_text.num_lines;
+        (*num_sequences)++;
+        free_parsed_text(split_text);
+    }
+
+    free_parsed_text(parsed_text);
+
+    return (sequences);
+}
+
+/*
+ * report_scaling
+ *
+ * Time playing the calls through the index against finding every card's win
+ * in parallel, for every thread count from 1 to the number of online cores,
+ * and check they agree on the call and score of every card's win.
+ *
+ * Argument: file_name
+ *     File of bingo calls and cards to time on.
+ *
+ * Return: void
+ */
+static void
+report_scaling(char *file_name)
+{
+    bingo_calls_type  bingo_calls;
+    bingo_cards_type  bingo_cards;
+    bingo_index_type  index;
+    bingo_mask_type  *marked = NULL;
+    bingo_win_type   *expected_wins = NULL;
+    bingo_win_type   *wins = NULL;
+    size_t           *order = NULL;
+    size_t            num_threads, max_threads;
+    size_t            i;
+    struct timespec   start_time, end_time;
+    char              description[64];
+
+    read_calls_and_cards(file_name, &bingo_calls, &bingo_cards);
+    max_threads = MAX(1, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%zu cards, %d calls, %zu cores\n", bingo_cards.num_cards,
+           bingo_calls.num_calls, max_threads);
+
+    marked = malloc_b(bingo_cards.num_cards * sizeof(bingo_mask_type));
+    expected_wins = malloc_b(bingo_cards.num_cards * sizeof(bingo_win_type));
+    wins = malloc_b(bingo_cards.num_cards * sizeof(bingo_win_type));
+    order = malloc_b(bingo_cards.num_cards * sizeof(size_t));
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+    index = make_bingo_index(bingo_cards);
+    play_bingo_calls(bingo_calls, bingo_cards, index, marked, expected_wins);
+    order_card_wins(expected_wins, bingo_cards.num_cards,
+                    bingo_calls.num_calls, order);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+    print_elapsed_time(find_elapsed_time_ns(start_time, end_time),
+                       "Serial index");
+
+    for (num_threads = 1; num_threads <= max_threads; num_threads++) {
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+        find_card_wins_parallel(bingo_calls, bingo_cards, num_threads, wins);
+        order_card_wins(wins, bingo_cards.num_cards, bingo_calls.num_calls,
+                        order);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+        for (i = 0; i < bingo_cards.num_cards; i++) {
+            assert(wins[i].call_index == expected_wins[i].call_index);
+            assert(wins[i].card_score == expected_wins[i].card_score);
         }
+        snprintf(description, sizeof(description), "Parallel, %zu threads",
+                 num_threads);
+        print_elapsed_time(find_elapsed_time_ns(start_time, end_time),
+                           description);
     }
-    /* All cards should have won above */
-    assert(non_winners.num_cards == 0);
-    assert(last_winner != NULL);
-    last_winner_ret = *last_winner;
 
-    free(non_winners.cards);
-    free(non_winners_copy.cards);
+    free(order);
+    order = NULL;
+    free(wins);
+    wins = NULL;
+    free(expected_wins);
+    expected_wins = NULL;
+    free(marked);
+    marked = NULL;
+    free_bingo_index(&index);
+    free(bingo_cards.cards);
+    bingo_cards.cards = NULL;
+    free(bingo_calls.calls);
+    bingo_calls.calls = NULL;
+}
+
+/*
+ * print_nth_winner
+ *
+ * Print the nth card to win, using all online cores.
+ *
+ * Argument: file_name
+ *     File of bingo calls and cards.
+ * Argument: n
+ *     Position of the winner to print, from 1 to the number of cards.
+ *
+ * Return: void
+ */
+static void
+print_nth_winner(char *file_name, size_t n)
+{
+    bingo_calls_type  bingo_calls;
+    bingo_cards_type  bingo_cards;
+    bingo_win_type   *wins = NULL;
+    size_t           *order = NULL;
+    bingo_win_type    win;
+
+    read_calls_and_cards(file_name, &bingo_calls, &bingo_cards);
+    assert(n > 0 && n <= bingo_cards.num_cards);
 
-    return (last_winner_ret);
+    wins = malloc_b(bingo_cards.num_cards * sizeof(bingo_win_type));
+    order = malloc_b(bingo_cards.num_cards * sizeof(size_t));
+    find_card_wins_parallel(bingo_calls, bingo_cards,
+                            find_num_threads(bingo_cards.num_cards,
+                                             MIN_CARDS_PER_THREAD),
+                            wins);
+    order_card_wins(wins, bingo_cards.num_cards, bingo_calls.num_calls, order);
+
+    win = wins[order[n - 1]];
+    if (win.call_index == NEVER_CALLED) {
+        printf("Winner %zu: Fewer than %zu cards win\n", n, n);
+    } else {
+        printf("Winner %zu: Card = %zu, Winning number = %d, "
+               "Card score = %d, N*S = %d\n",
+               n, win.card + 1, win.winning_number, win.card_score,
+               win.winning_number * win.card_score);
+    }
+
+    free(order);
+    order = NULL;
+    free(wins);
+    wins = NULL;
+    free(bingo_cards.cards);
+    bingo_cards.cards = NULL;
+    free(bingo_calls.calls);
+    bingo_calls.calls = NULL;
+}
+
+/*
+ * print_batch_winners
+ *
+ * Play every call sequence in a file against the cards in another, using all
+ * online cores, and print the first and last winners of each sequence.
+ *
+ * Argument: file_name
+ *     File of bingo calls and cards. Its calls are ignored.
+ * Argument: sequences_file_name
+ *     File of call sequences, one comma-separated sequence per line.
+ *
+ * Return: void
+ */
+static void
+print_batch_winners(char *file_name, char *sequences_file_name)
+{
+    bingo_calls_type  bingo_calls;
+    bingo_cards_type  bingo_cards;
+    bingo_index_type  index;
+    bingo_calls_type *sequences = NULL;
+    size_t            num_sequences;
+    bingo_win_type   *wins = NULL;
+    size_t           *order = NULL;
+    bingo_win_type   *sequence_wins = NULL;
+    bingo_win_type    first_winner;
+    bingo_win_type    last_winner;
+    size_t            i;
+
+    read_calls_and_cards(file_name, &bingo_calls, &bingo_cards);
+    sequences = read_call_sequences(sequences_file_name, &num_sequences);
+    index = make_bingo_index(bingo_cards);
+
+    wins = malloc_b(num_sequences * bingo_cards.num_cards
+                    * sizeof(bingo_win_type));
+    order = malloc_b(bingo_cards.num_cards * sizeof(size_t));
+    play_bingo_batch(sequences, num_sequences, bingo_cards, index,
+                     MAX(1, sysconf(_SC_NPROCESSORS_ONLN)), wins);
+
+    for (i = 0; i < num_sequences; i++) {
+        sequence_wins = &(wins[i * bingo_cards.num_cards]);
+        order_card_wins(sequence_wins, bingo_cards.num_cards,
+                        sequences[i].num_calls, order);
+        first_winner = sequence_wins[order[0]];
+        last_winner = sequence_wins[order[bingo_cards.num_cards - 1]];
+        printf("Sequence %zu: ", i + 1);
+        if (first_winner.call_index == NEVER_CALLED) {
+            printf("No winners\n");
+            continue;
+        }
+        printf("First winner = card %zu, N*S = %d, ", first_winner.card + 1,
+               first_winner.winning_number * first_winner.card_score);
+        if (last_winner.call_index == NEVER_CALLED) {
+            printf("Not every card wins\n");
+        } else {
+            printf("Last winner = card %zu, N*S = %d\n", last_winner.card + 1,
+                   last_winner.winning_number * last_winner.card_score);
+        }
+    }
+
+    free(order);
+    order = NULL;
+    free(wins);
+    wins = NULL;
+    for (i = 0; i < num_sequences; i++) {
+        free(sequences[i].calls);
+        sequences[i].calls = NULL;
+    }
+    free(sequences);
+    sequences = NULL;
+    free_bingo_index(&index);
+    free(bingo_cards.cards);
+    bingo_cards.cards = NULL;
+    free(bingo_calls.calls);
+    bingo_calls.calls = NULL;
 }
 
 /*
@@ -414,52 +1106,81 @@ find_last_winner(bingo_calls_type  bingo_calls,
 static void
 runner(char *file_name, bool print_output)
 {
-    parsed_text_type  parsed_text;
     bingo_calls_type  bingo_calls;
     bingo_cards_type  bingo_cards;
-    bingo_card_type   line_winner;
-    int               winning_number;
-    bingo_card_type   last_winner;
-    int               last_number;
-    int               card_score;
+    bingo_win_type   *wins = NULL;
+    size_t           *order = NULL;
+    bingo_win_type    first_winner;
+    bingo_win_type    last_winner;
 
-    parsed_text = parse_file(file_name);
+    read_calls_and_cards(file_name, &bingo_calls, &bingo_cards);
 
-    parse_lines_into_calls_and_cards(parsed_text, &bingo_calls, &bingo_cards);
+    wins = malloc_b(bingo_cards.num_cards * sizeof(bingo_win_type));
+    order = malloc_b(bingo_cards.num_cards * sizeof(size_t));
+    find_card_wins_parallel(bingo_calls, bingo_cards,
+                            find_num_threads(bingo_cards.num_cards,
+                                             MIN_CARDS_PER_THREAD),
+                            wins);
+    order_card_wins(wins, bingo_cards.num_cards, bingo_calls.num_calls, order);
 
-    line_winner = find_bingo_winner(bingo_calls, bingo_cards, &winning_number);
-    card_score = find_sum_of_unmarked_numbers(line_winner);
-    if (print_output) {
-        printf("Part 1: Winning number = %d, Card score = %d, N*S = %d\n",
-               winning_number,
-               card_score,
-               winning_number * card_score);
-    }
+    first_winner = wins[order[0]];
+    last_winner = wins[order[bingo_cards.num_cards - 1]];
+    /* Every card should win */
+    assert(last_winner.call_index != NEVER_CALLED);
 
-    last_winner = find_last_winner(bingo_calls, bingo_cards, &last_number);
-    card_score = find_sum_of_unmarked_numbers(last_winner);
     if (print_output) {
+        printf("Part 1: Winning number = %d, Card score = %d, N*S = %d\n",
+               first_winner.winning_number,
+               first_winner.card_score,
+               first_winner.winning_number * first_winner.card_score);
         printf("Part 2: Last winning number = %d, Card score = %d, N*S = %d\n",
-               last_number,
-               card_score,
-               last_number * card_score);
+               last_winner.winning_number,
+               last_winner.card_score,
+               last_winner.winning_number * last_winner.card_score);
     }
 
+    free(order);
+    order = NULL;
+    free(wins);
+    wins = NULL;
     free(bingo_cards.cards);
     bingo_cards.cards = NULL;
     free(bingo_calls.calls);
     bingo_calls.calls = NULL;
-    free_parsed_text(parsed_text);
 }
 
 /*
  * Main function.
+ *
+ * Usage:
+ *   day_04 <file>
+ *       Solve both parts.
+ *   day_04 --scaling <file>
+ *       Time the serial index and parallel versions for 1 to all cores.
+ *   day_04 --winner <file> <n>
+ *       Print the nth card to win.
+ *   day_04 --batch <file> <sequences_file>
+ *       Print the first and last winners of the cards in file for each call
+ *       sequence in sequences_file.
  */
 int
 main(int argc, char **argv)
 {
     char *file_name = NULL;
 
+    if (argc == 3 && STRS_EQUAL(argv[1], "--scaling")) {
+        report_scaling(argv[2]);
+        return (0);
+    }
+    if (argc == 4 && STRS_EQUAL(argv[1], "--winner")) {
+        print_nth_winner(argv[2], strtoul(argv[3], NULL, 10));
+        return (0);
+    }
+    if (argc == 4 && STRS_EQUAL(argv[1], "--batch")) {
+        print_batch_winners(argv[2], argv[3]);
+        return (0);
+    }
+
     assert(argc == 2);
     file_name = argv[1];
 
@@ -3,27 +3,77 @@
  */
 
 #include <stdint.h>
+#include <unistd.h>
 
 #include "utils.h"
 
+/*
+ * Largest grid, in cells, to rasterise the lines into. Larger inputs are
+ * counted by sweeping the lines instead.
+ */
+#define MAX_DENSE_GRID_CELLS (1 << 27)
+
+/* Bits per word of a grid bitplane */
+#define BITS_PER_WORD 64
+
+/*
+ * Bytes of both bitplanes in each tile of rows rasterised in parallel, so a
+ * tile stays in a core's L2 cache while its lines are drawn.
+ */
+#define TILE_CACHE_BYTES (256 * 1024)
+
+/* Fewest positions drawn worth giving a thread of their own */
+#define MIN_POSITIONS_PER_THREAD (1 << 18)
+
+/*
+ * line_kinds_enum_type
+ *
+ * Which kinds of line to rasterise. Can be combined with a bitwise or.
+ *
+ * Element: NON_DIAGONAL_LINES
+ *     Horizontal and vertical lines.
+ * Element: DIAGONAL_LINES
+ *     Lines at 45 degrees.
+ * Element: ALL_LINES
+ *     Every line.
+ */
+typedef enum Line_Kinds_Enum {
+    NON_DIAGONAL_LINES = 1 << 0,
+    DIAGONAL_LINES     = 1 << 1,
+    ALL_LINES          = NON_DIAGONAL_LINES | DIAGONAL_LINES,
+} line_kinds_enum_type;
+
 /*
  * grid_type
  *
- * Element: columns
- *     Array of columns. Each line is an array of integers.
+ * Grid of how many lines cover each position, saturating at 2, stored as two
+ * row-major bitplanes. The number of positions covered at least twice is kept
+ * up to date as lines are added.
+ *
+ * Element: hit_once
+ *     Bitplane of positions covered by at least one line. Bit x % 64 of word
+ *     y * words_per_row + x / 64 is position (x, y).
+ * Element: hit_twice
+ *     Bitplane of positions covered by at least two lines, laid out as
+ *     hit_once.
+ * Element: words_per_row
+ *     Number of words in each row of a bitplane.
  * Element: max_x
- *     The maximum x coordinate of the grid. Corresponds to the number of
- *     elements in the columns array. max_x is the furthest-right element in
- *     the grid.
+ *     The maximum x coordinate of the grid. max_x is the furthest-right
+ *     element in the grid.
  * Element: max_y
- *     The maximum y coordinate of the grid. Corresponds to the number of
- *     elements in each line in the columns array. max_y is the furthest-down
+ *     The maximum y coordinate of the grid. max_y is the furthest-down
  *     element in the grid.
+ * Element: num_intersecting
+ *     Number of positions covered by at least two lines.
  */
 typedef struct Grid {
-    uint16_t **columns;
-    uint16_t   max_x;
-    uint16_t   max_y;
+    uint64_t *hit_once;
+    uint64_t *hit_twice;
+    size_t    words_per_row;
+    uint32_t  max_x;
+    uint32_t  max_y;
+    size_t    num_intersecting;
 } grid_type;
 
 /*
@@ -39,12 +89,88 @@ typedef struct Grid {
  *     y coordinate of the end of the line.
  */
 typedef struct Line {
-    uint16_t x_start;
-    uint16_t y_start;
-    uint16_t x_end;
-    uint16_t y_end;
+    uint32_t x_start;
+    uint32_t y_start;
+    uint32_t x_end;
+    uint32_t y_end;
 } line_type;
 
+/*
+ * grid_tiles_type
+ *
+ * Lines binned into tiles of whole rows of a grid. The rows of a tile share no
+ * bitplane words with any other tile.
+ *
+ * Element: tile_rows
+ *     Number of rows in each tile. The last tile may be shorter.
+ * Element: num_tiles
+ *     Number of tiles.
+ * Element: offsets
+ *     Array of num_tiles + 1 offsets into line_indices. The lines crossing
+ *     tile t are line_indices[offsets[t]] to line_indices[offsets[t + 1] - 1].
+ * Element: line_indices
+ *     Indices of the lines crossing each tile, grouped by tile.
+ */
+typedef struct Grid_Tiles {
+    size_t    tile_rows;
+    size_t    num_tiles;
+    size_t   *offsets;
+    uint32_t *line_indices;
+} grid_tiles_type;
+
+/*
+ * grid_tile_chunk_type
+ *
+ * Work for one thread rasterising every num_threads'th tile of a grid.
+ *
+ * Element: grid
+ *     Copy of the grid sharing its bitplanes. Only rows of this chunk's tiles
+ *     are written, and num_intersecting counts only the positions they make
+ *     covered twice.
+ * Element: lines
+ *     Array of all line structs.
+ * Element: tiles
+ *     Lines binned into tiles.
+ * Element: first_tile
+ *     Index of the first tile of the chunk.
+ * Element: tile_stride
+ *     Distance between the tiles of the chunk.
+ */
+typedef struct Grid_Tile_Chunk {
+    grid_type        grid;
+    line_type       *lines;
+    grid_tiles_type  tiles;
+    size_t           first_tile;
+    size_t           tile_stride;
+} grid_tile_chunk_type;
+
+/*
+ * sweep_segment_type
+ *
+ * A line as seen by a sweep down the rows. The cells it covers in row y are
+ * x_start + dx * (y - y_top) to x_end + dx * (y - y_top), for y from y_top to
+ * y_bottom. Only horizontal lines cover more than one cell in a row.
+ *
+ * Element: y_top
+ *     First row of the line.
+ * Element: y_bottom
+ *     Last row of the line.
+ * Element: x_start
+ *     Leftmost cell of the line in its current row.
+ * Element: x_end
+ *     Rightmost cell of the line in its current row.
+ * Element: dx
+ *     Change in x per row: 0 for horizontal and vertical lines, -1 or 1 for
+ *     diagonal lines.
+ */
+typedef struct Sweep_Segment {
+    int64_t y_top;
+    int64_t y_bottom;
+    int64_t x_start;
+    int64_t x_end;
+    int     dx;
+} sweep_segment_type;
+
 /*
  * parse_text_into_line_type
  *
@@ -63,7 +189,7 @@ parse_text_into_line_type(char *text)
     line_type parsed_line;
 
     sscanf(text,
-           "%hu,%hu -> %hu,%hu",
+           "%u,%u -> %u,%u",
            &parsed_line.x_start,
            &parsed_line.y_start,
            &parsed_line.x_end,
@@ -94,10 +220,13 @@ parse_lines_and_make_grid(parsed_text_type   parsed_text,
                           grid_type         *grid,
                           line_type        **lines)
 {
-    uint16_t i;
+    size_t i;
 
     /* Set initial sensible values */
-    grid->columns = NULL;
+    grid->hit_once = NULL;
+    grid->hit_twice = NULL;
+    grid->words_per_row = 0;
+    grid->num_intersecting = 0;
     grid->max_x = 0;
     grid->max_y = 0;
     *lines = NULL;
@@ -106,23 +235,131 @@ parse_lines_and_make_grid(parsed_text_type   parsed_text,
 
     for (i = 0; i < parsed_text.num_lines; i++) {
         (*lines)[i] = parse_text_into_line_type(parsed_text.lines[i].line);
-        if ((*lines)[i].x_start > grid->max_x) {
-            grid->max_x = (*lines)[i].x_start;
-        } else if ((*lines)[i].x_end > grid->max_x) {
-            grid->max_x = (*lines)[i].x_end;
-        }
-        if ((*lines)[i].y_start > grid->max_y) {
-            grid->max_y = (*lines)[i].y_start;
-        } else if ((*lines)[i].y_end > grid->max_y) {
-            grid->max_y = (*lines)[i].y_end;
-        }
+        grid->max_x = MAX(grid->max_x, MAX((*lines)[i].x_start,
+                                           (*lines)[i].x_end));
+        grid->max_y = MAX(grid->max_y, MAX((*lines)[i].y_start,
+                                           (*lines)[i].y_end));
+    }
+
+    if (((uint64_t) grid->max_x + 1) * ((uint64_t) grid->max_y + 1)
+        > MAX_DENSE_GRID_CELLS) {
+        /* Too big to rasterise, leave the grid unallocated */
+        return;
     }
 
-    grid->columns = malloc_b((grid->max_x + 1) * sizeof(uint16_t *));
+    grid->words_per_row = ((size_t) grid->max_x + BITS_PER_WORD)
+                          / BITS_PER_WORD;
+    grid->hit_once = calloc_b(grid->words_per_row * ((size_t) grid->max_y + 1),
+                              sizeof(uint64_t));
+    grid->hit_twice = calloc_b(grid->words_per_row * ((size_t) grid->max_y + 1),
+                               sizeof(uint64_t));
+}
+
+/*
+ * free_grid
+ *
+ * Free allocated memory from the grid struct.
+ *
+ * Argument: grid
+ *     grid_type struct to free.
+ *
+ * Return: void
+ */
+static void
+free_grid(grid_type *grid)
+{
+    free(grid->hit_twice);
+    grid->hit_twice = NULL;
+    free(grid->hit_once);
+    grid->hit_once = NULL;
+}
 
-    for (i = 0; i <= grid->max_x; i++) {
-        grid->columns[i] = calloc_b(grid->max_y + 1, sizeof(uint16_t));
+/*
+ * add_to_grid_word
+ *
+ * Add one more line covering the positions in a mask of a bitplane word, and
+ * count the positions which this makes covered twice.
+ *
+ * Argument: grid
+ *     Grid to add to.
+ * Argument: word
+ *     Index of the word in each bitplane.
+ * Argument: mask
+ *     Positions in the word which the line covers.
+ *
+ * Return: void
+ */
+static inline void
+add_to_grid_word(grid_type *grid, size_t word, uint64_t mask)
+{
+    uint64_t newly_twice;
+
+    newly_twice = grid->hit_once[word] & ~grid->hit_twice[word] & mask;
+    grid->num_intersecting += __builtin_popcountll(newly_twice);
+    grid->hit_twice[word] |= newly_twice;
+    grid->hit_once[word] |= mask;
+}
+
+/*
+ * add_horizontal_run_to_grid
+ *
+ * Add a horizontal run of positions to the grid a word at a time.
+ *
+ * Argument: grid
+ *     Grid to add to.
+ * Argument: y
+ *     Row of the run.
+ * Argument: x_start
+ *     Leftmost position of the run.
+ * Argument: x_end
+ *     Rightmost position of the run.
+ *
+ * Return: void
+ */
+static void
+add_horizontal_run_to_grid(grid_type *grid,
+                           uint32_t   y,
+                           uint32_t   x_start,
+                           uint32_t   x_end)
+{
+    size_t   row_start = (size_t) y * grid->words_per_row;
+    size_t   first_word = x_start / BITS_PER_WORD;
+    size_t   last_word = x_end / BITS_PER_WORD;
+    uint64_t first_mask = ~(uint64_t) 0 << (x_start % BITS_PER_WORD);
+    uint64_t last_mask = ~(uint64_t) 0 >> (BITS_PER_WORD - 1
+                                           - x_end % BITS_PER_WORD);
+    size_t   word;
+
+    if (first_word == last_word) {
+        add_to_grid_word(grid, row_start + first_word, first_mask & last_mask);
+        return;
     }
+    add_to_grid_word(grid, row_start + first_word, first_mask);
+    for (word = first_word + 1; word < last_word; word++) {
+        add_to_grid_word(grid, row_start + word, ~(uint64_t) 0);
+    }
+    add_to_grid_word(grid, row_start + last_word, last_mask);
+}
+
+/*
+ * add_position_to_grid
+ *
+ * Add a single position to the grid.
+ *
+ * Argument: grid
+ *     Grid to add to.
+ * Argument: x
+ *     x coordinate of the position.
+ * Argument: y
+ *     y coordinate of the position.
+ *
+ * Return: void
+ */
+static inline void
+add_position_to_grid(grid_type *grid, size_t x, size_t y)
+{
+    add_to_grid_word(grid, y * grid->words_per_row + x / BITS_PER_WORD,
+                     (uint64_t) 1 << (x % BITS_PER_WORD));
 }
 
 /*
@@ -141,12 +378,12 @@ parse_lines_and_make_grid(parsed_text_type   parsed_text,
  * Return: void
  */
 static void
-fill_in_grid_with_non_diagonal_lines(grid_type  grid,
+fill_in_grid_with_non_diagonal_lines(grid_type *grid,
                                      line_type *lines,
                                      size_t     num_lines)
 {
     size_t   i, j;
-    uint16_t start, end;
+    uint32_t start, end;
 
     for (i = 0; i < num_lines; i++) {
         if (lines[i].x_start == lines[i].x_end) {
@@ -154,15 +391,13 @@ fill_in_grid_with_non_diagonal_lines(grid_type  grid,
             start = lines[i].y_start < lines[i].y_end ? lines[i].y_start : lines[i].y_end;
             end = lines[i].y_end > lines[i].y_start ? lines[i].y_end : lines[i].y_start;
             for (j = start; j <= end; j++) {
-                grid.columns[lines[i].x_start][j]++;
+                add_position_to_grid(grid, lines[i].x_start, j);
             }
         } else if (lines[i].y_start == lines[i].y_end) {
             // Horizontal line.
             start = lines[i].x_start < lines[i].x_end ? lines[i].x_start : lines[i].x_end;
             end = lines[i].x_end > lines[i].x_start ? lines[i].x_end : lines[i].x_start;
-            for (j = start; j <= end; j++) {
-                grid.columns[j][lines[i].y_start]++;
-            }
+            add_horizontal_run_to_grid(grid, lines[i].y_start, start, end);
         } else {
             // A diagonal line, skip.
             continue;
@@ -186,7 +421,7 @@ fill_in_grid_with_non_diagonal_lines(grid_type  grid,
  * Return: void
  */
 static void
-fill_in_grid_with_diagonal_lines(grid_type  grid,
+fill_in_grid_with_diagonal_lines(grid_type *grid,
                                  line_type *lines,
                                  size_t     num_lines)
 {
@@ -197,13 +432,13 @@ fill_in_grid_with_diagonal_lines(grid_type  grid,
         if (lines[i].x_start != lines[i].x_end
             && lines[i].y_start != lines[i].y_end) {
             // Diagonal line. Make sure it has a gradient of 1.
-            assert(abs(lines[i].x_end - lines[i].x_start)
-                   == abs(lines[i].y_end - lines[i].y_start));
+            assert(labs((int64_t) lines[i].x_end - lines[i].x_start)
+                   == labs((int64_t) lines[i].y_end - lines[i].y_start));
 
             x_increasing = (lines[i].x_end > lines[i].x_start);
             y_increasing = (lines[i].y_end > lines[i].y_start);
             for (x = lines[i].x_start, y = lines[i].y_start;;) {
-                grid.columns[x][y]++;
+                add_position_to_grid(grid, x, y);
                 if (x == lines[i].x_end || y == lines[i].y_end) {
                     // At the end of the line.
                     break;
@@ -227,32 +462,851 @@ fill_in_grid_with_diagonal_lines(grid_type  grid,
 }
 
 /*
- * find_number_of_intersecting_lines
+ * is_diagonal_line
+ *
+ * Whether a line is diagonal.
+ *
+ * Argument: line
+ *     Line to check.
+ *
+ * Return: bool
+ */
+static inline bool
+is_diagonal_line(line_type line)
+{
+    return (line.x_start != line.x_end && line.y_start != line.y_end);
+}
+
+/*
+ * make_grid_tiles
+ *
+ * Bin the lines of some kinds into tiles of rows sized by TILE_CACHE_BYTES,
+ * with a counting sort on the tiles each line crosses.
+ *
+ * Argument: grid
+ *     Grid the lines will be rasterised into.
+ * Argument: lines
+ *     Array of line structs.
+ * Argument: num_lines
+ *     Number of lines in the array.
+ * Argument: kinds
+ *     Which kinds of line to bin. Other lines are skipped.
+ *
+ * Return: grid_tiles_type
+ */
+static grid_tiles_type
+make_grid_tiles(grid_type             grid,
+                line_type            *lines,
+                size_t                num_lines,
+                line_kinds_enum_type  kinds)
+{
+    grid_tiles_type tiles;
+    size_t          row_bytes;
+    size_t         *next = NULL;
+    size_t          i, t;
+    size_t          first_tile, last_tile;
+    bool            diagonal;
+
+    assert(num_lines <= UINT32_MAX);
+
+    row_bytes = 2 * grid.words_per_row * sizeof(uint64_t);
+    tiles.tile_rows = MAX(1, TILE_CACHE_BYTES / row_bytes);
+    tiles.num_tiles = ((size_t) grid.max_y + tiles.tile_rows)
+                      / tiles.tile_rows;
+    tiles.offsets = calloc_b(tiles.num_tiles + 1, sizeof(size_t));
+    next = malloc_b(tiles.num_tiles * sizeof(size_t));
+
+    /* Count the lines crossing each tile, offset by one */
+    for (i = 0; i < num_lines; i++) {
+        diagonal = is_diagonal_line(lines[i]);
+        if (!(kinds & (diagonal ? DIAGONAL_LINES : NON_DIAGONAL_LINES))) {
+            continue;
+        }
+        if (diagonal) {
+            // Make sure it has a gradient of 1.
+            assert(labs((int64_t) lines[i].x_end - lines[i].x_start)
+                   == labs((int64_t) lines[i].y_end - lines[i].y_start));
+        }
+        first_tile = MIN(lines[i].y_start, lines[i].y_end) / tiles.tile_rows;
+        last_tile = MAX(lines[i].y_start, lines[i].y_end) / tiles.tile_rows;
+        for (t = first_tile; t <= last_tile; t++) {
+            tiles.offsets[t + 1]++;
+        }
+    }
+    for (t = 0; t < tiles.num_tiles; t++) {
+        tiles.offsets[t + 1] += tiles.offsets[t];
+        next[t] = tiles.offsets[t];
+    }
+
+    tiles.line_indices = malloc_b(MAX(1, tiles.offsets[tiles.num_tiles])
+                                  * sizeof(uint32_t));
+    for (i = 0; i < num_lines; i++) {
+        diagonal = is_diagonal_line(lines[i]);
+        if (!(kinds & (diagonal ? DIAGONAL_LINES : NON_DIAGONAL_LINES))) {
+            continue;
+        }
+        first_tile = MIN(lines[i].y_start, lines[i].y_end) / tiles.tile_rows;
+        last_tile = MAX(lines[i].y_start, lines[i].y_end) / tiles.tile_rows;
+        for (t = first_tile; t <= last_tile; t++) {
+            tiles.line_indices[next[t]++] = i;
+        }
+    }
+
+    free(next);
+    next = NULL;
+
+    return (tiles);
+}
+
+/*
+ * free_grid_tiles
+ *
+ * Free allocated memory from the grid tiles struct.
+ *
+ * Argument: tiles
+ *     grid_tiles_type struct to free.
+ *
+ * Return: void
+ */
+static void
+free_grid_tiles(grid_tiles_type *tiles)
+{
+    free(tiles->line_indices);
+    tiles->line_indices = NULL;
+    free(tiles->offsets);
+    tiles->offsets = NULL;
+}
+
+/*
+ * add_line_rows_to_grid
  *
- * Finds the number of grid positions where at least two lines overlap.
+ * Add the part of a horizontal, vertical or diagonal line within a range of
+ * rows to the grid.
  *
  * Argument: grid
- *     Grid with lines added.
+ *     Grid to add to.
+ * Argument: line
+ *     Line to add. Diagonal lines must have a gradient of 1.
+ * Argument: first_row
+ *     First row to add the line to.
+ * Argument: last_row
+ *     Last row to add the line to.
+ *
+ * Return: void
+ */
+static void
+add_line_rows_to_grid(grid_type *grid,
+                      line_type  line,
+                      size_t     first_row,
+                      size_t     last_row)
+{
+    size_t  y_top, y_bottom, x_top;
+    size_t  y;
+    int64_t dx;
+
+    if (line.y_start == line.y_end) {
+        // Horizontal line, which is within the rows if it was binned here.
+        add_horizontal_run_to_grid(grid, line.y_start,
+                                   MIN(line.x_start, line.x_end),
+                                   MAX(line.x_start, line.x_end));
+        return;
+    }
+
+    y_top = MIN(line.y_start, line.y_end);
+    y_bottom = MAX(line.y_start, line.y_end);
+    x_top = line.y_start < line.y_end ? line.x_start : line.x_end;
+    dx = (line.x_start == line.x_end) ? 0
+         : ((line.x_start < line.x_end) == (line.y_start < line.y_end)) ? 1
+         : -1;
+    for (y = MAX(y_top, first_row); y <= MIN(y_bottom, last_row); y++) {
+        add_position_to_grid(grid, x_top + dx * (int64_t) (y - y_top), y);
+    }
+}
+
+/*
+ * rasterise_tiles_chunk
+ *
+ * Thread function to add the lines crossing a chunk's tiles to the grid,
+ * clipped to the rows of each tile.
+ *
+ * Argument: arg
+ *     grid_tile_chunk_type of the chunk.
+ *
+ * Return: void *
+ */
+static void *
+rasterise_tiles_chunk(void *arg)
+{
+    grid_tile_chunk_type *chunk = arg;
+    grid_tiles_type      *tiles = &(chunk->tiles);
+    size_t                first_row, last_row;
+    size_t                t, i;
+
+    for (t = chunk->first_tile; t < tiles->num_tiles; t += chunk->tile_stride) {
+        first_row = t * tiles->tile_rows;
+        last_row = MIN(first_row + tiles->tile_rows - 1, chunk->grid.max_y);
+        for (i = tiles->offsets[t]; i < tiles->offsets[t + 1]; i++) {
+            add_line_rows_to_grid(&(chunk->grid),
+                                  chunk->lines[tiles->line_indices[i]],
+                                  first_row, last_row);
+        }
+    }
+
+    return (NULL);
+}
+
+/*
+ * find_num_positions_to_draw
+ *
+ * Find how many positions drawing some lines visits, to scale the number of
+ * threads by.
+ *
+ * Argument: lines
+ *     Array of line structs.
+ * Argument: num_lines
+ *     Number of lines in the array.
+ *
+ * Return: size_t
+ */
+static size_t
+find_num_positions_to_draw(line_type *lines, size_t num_lines)
+{
+    size_t num_positions = 0;
+    size_t i;
+
+    for (i = 0; i < num_lines; i++) {
+        num_positions += 1 + MAX(labs((int64_t) lines[i].x_end
+                                      - lines[i].x_start),
+                                 labs((int64_t) lines[i].y_end
+                                      - lines[i].y_start));
+    }
+
+    return (num_positions);
+}
+
+/*
+ * rasterise_lines_parallel
+ *
+ * Add the lines of some kinds to the grid in one pass, with the grid split
+ * into tiles of rows which are dealt out to the threads in turn. Each thread
+ * draws only the rows of its own tiles, and tiles share no bitplane words, so
+ * no atomics are needed.
+ *
+ * Argument: grid
+ *     Grid to add to.
+ * Argument: lines
+ *     Array of line structs.
+ * Argument: num_lines
+ *     Number of lines in the array.
+ * Argument: kinds
+ *     Which kinds of line to add. Other lines are skipped.
+ * Argument: num_threads
+ *     Number of threads to use.
+ *
+ * Return: void
+ */
+static void
+rasterise_lines_parallel(grid_type            *grid,
+                         line_type            *lines,
+                         size_t                num_lines,
+                         line_kinds_enum_type  kinds,
+                         size_t                num_threads)
+{
+    grid_tiles_type       tiles;
+    grid_tile_chunk_type *chunks = NULL;
+    size_t                i;
+
+    assert(num_threads > 0);
+
+    tiles = make_grid_tiles(*grid, lines, num_lines, kinds);
+    num_threads = MIN(num_threads, tiles.num_tiles);
+
+    chunks = malloc_b(num_threads * sizeof(grid_tile_chunk_type));
+    for (i = 0; i < num_threads; i++) {
+        chunks[i].grid = *grid;
+        chunks[i].grid.num_intersecting = 0;
+        chunks[i].lines = lines;
+        chunks[i].tiles = tiles;
+        chunks[i].first_tile = i;
+        chunks[i].tile_stride = num_threads;
+    }
+    run_threads(chunks, sizeof(grid_tile_chunk_type), num_threads,
+                rasterise_tiles_chunk);
+    for (i = 0; i < num_threads; i++) {
+        grid->num_intersecting += chunks[i].grid.num_intersecting;
+    }
+
+    free(chunks);
+    chunks = NULL;
+    free_grid_tiles(&tiles);
+}
+
+/*
+ * compare_sweep_segments_by_row
+ *
+ * qsort comparison function to order sweep segments by their first row.
+ *
+ * Argument: a
+ *     Pointer to first sweep_segment_type.
+ * Argument: b
+ *     Pointer to second sweep_segment_type.
+ *
+ * Return: int
+ */
+static int
+compare_sweep_segments_by_row(const void *a, const void *b)
+{
+    const sweep_segment_type *segment_a = a;
+    const sweep_segment_type *segment_b = b;
+
+    return ((segment_a->y_top > segment_b->y_top) -
+            (segment_a->y_top < segment_b->y_top));
+}
+
+/*
+ * compare_sweep_segments_by_x
+ *
+ * qsort comparison function to order sweep segments by their leftmost cell in
+ * the current row.
+ *
+ * Argument: a
+ *     Pointer to first sweep_segment_type.
+ * Argument: b
+ *     Pointer to second sweep_segment_type.
+ *
+ * Return: int
+ */
+static int
+compare_sweep_segments_by_x(const void *a, const void *b)
+{
+    const sweep_segment_type *segment_a = a;
+    const sweep_segment_type *segment_b = b;
+
+    return ((segment_a->x_start > segment_b->x_start) -
+            (segment_a->x_start < segment_b->x_start));
+}
+
+/*
+ * resort_sweep_segments_by_x
+ *
+ * Restore the order of segments by x after diagonals have moved. Only lines
+ * which have crossed are out of order, so an insertion sort is linear in
+ * practice.
+ *
+ * Argument: segments
+ *     Array of segments, nearly sorted by x.
+ * Argument: num_segments
+ *     Number of elements in segments.
+ *
+ * Return: void
+ */
+static void
+resort_sweep_segments_by_x(sweep_segment_type *segments, size_t num_segments)
+{
+    sweep_segment_type segment;
+    size_t             i, j;
+
+    for (i = 1; i < num_segments; i++) {
+        if (segments[i - 1].x_start <= segments[i].x_start) {
+            continue;
+        }
+        segment = segments[i];
+        for (j = i; j > 0 && segments[j - 1].x_start > segment.x_start; j--) {
+            segments[j] = segments[j - 1];
+        }
+        segments[j] = segment;
+    }
+}
+
+/*
+ * make_sweep_segments
+ *
+ * Convert lines into sweep segments ordered by their first row.
+ *
+ * Argument: lines
+ *     Array of line structs.
+ * Argument: num_lines
+ *     Number of lines in the array.
+ * Argument: include_diagonals
+ *     Whether to include diagonal lines or skip them.
+ * Argument: num_segments
+ *     OUT: Number of segments made.
+ *
+ * Return: sweep_segment_type *
+ *     Array of segments. Must be freed by the caller.
+ */
+static sweep_segment_type *
+make_sweep_segments(line_type *lines,
+                    size_t     num_lines,
+                    bool       include_diagonals,
+                    size_t    *num_segments)
+{
+    sweep_segment_type *segments = NULL;
+    sweep_segment_type *segment = NULL;
+    line_type           line;
+    size_t              i;
+
+    segments = malloc_b(MAX(num_lines, 1) * sizeof(sweep_segment_type));
+    *num_segments = 0;
+    for (i = 0; i < num_lines; i++) {
+        line = lines[i];
+        segment = &(segments[*num_segments]);
+        if (line.y_start == line.y_end) {
+            // Horizontal line.
+            segment->y_top = line.y_start;
+            segment->y_bottom = line.y_start;
+            segment->x_start = MIN(line.x_start, line.x_end);
+            segment->x_end = MAX(line.x_start, line.x_end);
+            segment->dx = 0;
+        } else if (line.x_start == line.x_end || include_diagonals) {
+            // Vertical or diagonal line, orient it from its top row.
+            if (line.x_start != line.x_end) {
+                assert(labs((int64_t) line.x_end - line.x_start)
+                       == labs((int64_t) line.y_end - line.y_start));
+            }
+            if (line.y_start < line.y_end) {
+                segment->y_top = line.y_start;
+                segment->y_bottom = line.y_end;
+                segment->x_start = line.x_start;
+                segment->dx = (line.x_end > line.x_start) -
+                              (line.x_end < line.x_start);
+            } else {
+                segment->y_top = line.y_end;
+                segment->y_bottom = line.y_start;
+                segment->x_start = line.x_end;
+                segment->dx = (line.x_start > line.x_end) -
+                              (line.x_start < line.x_end);
+            }
+            segment->x_end = segment->x_start;
+        } else {
+            // A diagonal line, skip.
+            continue;
+        }
+        (*num_segments)++;
+    }
+
+    qsort(segments, *num_segments, sizeof(sweep_segment_type),
+          compare_sweep_segments_by_row);
+
+    return (segments);
+}
+
+/*
+ * count_cells_covered_twice
+ *
+ * Count the cells in a row covered by at least two of the given segments. A
+ * cell is covered twice exactly when a segment reaches it which starts no
+ * further right than an earlier segment which also reaches it, so with the
+ * segments in order this is one pass keeping the furthest cell covered so far.
+ *
+ * Argument: active
+ *     Array of segments covering the row, sorted by x.
+ * Argument: num_active
+ *     Number of elements in active.
  *
  * Return: size_t
  */
 static size_t
-find_number_of_intersecting_lines(grid_type grid)
+count_cells_covered_twice(sweep_segment_type *active, size_t num_active)
+{
+    size_t  num_covered = 0;
+    int64_t covered_end = INT64_MIN;
+    int64_t twice_end = INT64_MIN;
+    int64_t start, end;
+    size_t  i;
+
+    for (i = 0; i < num_active; i++) {
+        start = MAX(active[i].x_start, twice_end + 1);
+        end = MIN(active[i].x_end, covered_end);
+        if (end >= start) {
+            num_covered += end - start + 1;
+            twice_end = end;
+        }
+        covered_end = MAX(covered_end, active[i].x_end);
+    }
+
+    return (num_covered);
+}
+
+/*
+ * segments_meet_within_rows
+ *
+ * Check whether any two of the given segments could cover the same cell in
+ * the next num_rows rows, by checking whether the ranges of x they sweep
+ * through in those rows overlap. With the segments in order, the ranges are
+ * all disjoint exactly when each one ends before the next one starts.
+ *
+ * Argument: active
+ *     Array of segments, sorted by x at their position in the first row.
+ * Argument: num_active
+ *     Number of elements in active.
+ * Argument: num_rows
+ *     Number of rows to check, including the first.
+ *
+ * Return: bool
+ */
+static bool
+segments_meet_within_rows(sweep_segment_type *active,
+                          size_t              num_active,
+                          int64_t             num_rows)
 {
-    size_t   num_intersecting = 0;
-    uint16_t x, y;
+    int64_t previous_end = INT64_MIN;
+    int64_t shift;
+    size_t  i;
+
+    for (i = 0; i < num_active; i++) {
+        shift = active[i].dx * (num_rows - 1);
+        if (active[i].x_start + MIN(shift, 0) <= previous_end) {
+            return (true);
+        }
+        previous_end = active[i].x_end + MAX(shift, 0);
+    }
+
+    return (false);
+}
+
+/*
+ * sweep_number_of_intersecting_lines
+ *
+ * Finds the number of positions where at least two lines overlap without
+ * rasterising them, so memory is proportional to the number of lines rather
+ * than the size of the grid. Rows are swept from the top, keeping the lines
+ * covering the current row sorted by x. The rows between one line starting or
+ * ending and the next are handled together: if no diagonal lines are active
+ * every row has the same count so it is counted once and multiplied, and if
+ * the active lines cannot meet in those rows they are skipped. Otherwise they
+ * are counted one row at a time.
+ *
+ * Argument: lines
+ *     Array of line structs.
+ * Argument: num_lines
+ *     Number of lines in the array.
+ * Argument: include_diagonals
+ *     Whether to include diagonal lines or skip them.
+ *
+ * Return: size_t
+ */
+static size_t
+sweep_number_of_intersecting_lines(line_type *lines,
+                                   size_t     num_lines,
+                                   bool       include_diagonals)
+{
+    sweep_segment_type *segments = NULL;
+    sweep_segment_type *active = NULL;
+    sweep_segment_type *merged = NULL;
+    sweep_segment_type *tmp = NULL;
+    size_t              num_segments;
+    size_t              num_active;
+    size_t              num_diagonal;
+    size_t              next_segment, first_new;
+    size_t              num_intersecting;
+    int64_t             y, last_unchanged_row;
+    int64_t             num_rows;
+    size_t              i, j, k;
+
+    segments = make_sweep_segments(lines, num_lines, include_diagonals,
+                                   &num_segments);
+    active = malloc_b(MAX(num_segments, 1) * sizeof(sweep_segment_type));
+    merged = malloc_b(MAX(num_segments, 1) * sizeof(sweep_segment_type));
+
+    num_intersecting = 0;
+    num_active = 0;
+    num_diagonal = 0;
+    next_segment = 0;
+    y = 0;
+    while (num_active > 0 || next_segment < num_segments) {
+        if (num_active == 0) {
+            /* Skip straight to the next row with a line */
+            y = segments[next_segment].y_top;
+        }
+
+        /* Merge the lines starting on this row into the active lines */
+        first_new = next_segment;
+        while (next_segment < num_segments &&
+               segments[next_segment].y_top == y) {
+            num_diagonal += (segments[next_segment].dx != 0);
+            next_segment++;
+        }
+        if (next_segment > first_new) {
+            qsort(&segments[first_new], next_segment - first_new,
+                  sizeof(sweep_segment_type), compare_sweep_segments_by_x);
+            for (i = 0, j = first_new, k = 0;
+                 i < num_active || j < next_segment; k++) {
+                if (j == next_segment ||
+                    (i < num_active &&
+                     active[i].x_start <= segments[j].x_start)) {
+                    merged[k] = active[i++];
+                } else {
+                    merged[k] = segments[j++];
+                }
+            }
+            num_active = k;
+            tmp = active;
+            active = merged;
+            merged = tmp;
+        }
+
+        /* Find the last row before any line starts or ends */
+        last_unchanged_row = INT64_MAX;
+        if (next_segment < num_segments) {
+            last_unchanged_row = segments[next_segment].y_top - 1;
+        }
+        for (i = 0; i < num_active; i++) {
+            last_unchanged_row = MIN(last_unchanged_row, active[i].y_bottom);
+        }
+        num_rows = last_unchanged_row - y + 1;
+
+        if (num_active < 2) {
+            /* Nothing to overlap with */
+        } else if (num_diagonal == 0) {
+            /* Only straight lines, so every row has the same count */
+            num_intersecting += count_cells_covered_twice(active, num_active)
+                                * num_rows;
+        } else if (segments_meet_within_rows(active, num_active, num_rows)) {
+            /* Lines may meet, so count this row only */
+            num_intersecting += count_cells_covered_twice(active, num_active);
+            num_rows = 1;
+        }
 
-    for (x = 0; x <= grid.max_x; x++) {
-        for (y = 0; y <= grid.max_y; y++) {
-            if (grid.columns[x][y] > 1) {
-                num_intersecting++;
+        /*
+         * Move past the rows, dropping lines which end within them. Diagonals
+         * which cross change order, including ones which swap between the
+         * last row and the next without meeting.
+         */
+        y += num_rows;
+        for (i = 0, j = 0; i < num_active; i++) {
+            if (active[i].y_bottom < y) {
+                num_diagonal -= (active[i].dx != 0);
+                continue;
             }
+            active[i].x_start += active[i].dx * num_rows;
+            active[i].x_end += active[i].dx * num_rows;
+            active[j++] = active[i];
+        }
+        num_active = j;
+        if (num_diagonal > 0) {
+            resort_sweep_segments_by_x(active, num_active);
         }
     }
 
+    free(merged);
+    merged = NULL;
+    free(active);
+    active = NULL;
+    free(segments);
+    segments = NULL;
+
     return (num_intersecting);
 }
 
+/*
+ * read_lines_and_make_grid
+ *
+ * Read a file of lines and make the grid for them.
+ *
+ * Argument: file_name
+ *     File to read lines from.
+ * Argument: grid
+ *     OUT: Struct of the grid, unallocated if it would be too big.
+ * Argument: lines
+ *     OUT: Array of line structs.
+ * Argument: num_lines
+ *     OUT: Number of lines in the array.
+ *
+ * Return: void
+ */
+static void
+read_lines_and_make_grid(char       *file_name,
+                         grid_type  *grid,
+                         line_type **lines,
+                         size_t     *num_lines)
+{
+    parsed_text_type parsed_text;
+
+    parsed_text = parse_file(file_name);
+    parse_lines_and_make_grid(parsed_text, grid, lines);
+    *num_lines = parsed_text.num_lines;
+    free_parsed_text(parsed_text);
+}
+
+/*
+ * clear_grid
+ *
+ * Remove every line from the grid.
+ *
+ * Argument: grid
+ *     Grid to clear.
+ *
+ * Return: void
+ */
+static void
+clear_grid(grid_type *grid)
+{
+    size_t num_words = grid->words_per_row * ((size_t) grid->max_y + 1);
+
+    memset(grid->hit_once, 0, num_words * sizeof(uint64_t));
+    memset(grid->hit_twice, 0, num_words * sizeof(uint64_t));
+    grid->num_intersecting = 0;
+}
+
+/*
+ * report_scaling
+ *
+ * Time the serial fills against the parallel tiled rasteriser, for every
+ * thread count from 1 to the number of online cores, and check they agree on
+ * both parts. Each parallel run draws the non-diagonal lines then the
+ * diagonal ones as the runner does, then every line again in a single pass.
+ *
+ * Argument: file_name
+ *     File of lines to time on. Must be small enough for a dense grid.
+ *
+ * Return: void
+ */
+static void
+report_scaling(char *file_name)
+{
+    grid_type        grid;
+    line_type       *lines = NULL;
+    size_t           num_lines;
+    size_t           expected_part_1, expected_part_2;
+    size_t           num_threads, max_threads;
+    struct timespec  start_time, end_time;
+    char             description[64];
+
+    read_lines_and_make_grid(file_name, &grid, &lines, &num_lines);
+    assert(grid.hit_once != NULL);
+    max_threads = MAX(1, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%zu lines, %u x %u grid, %zu cores\n", num_lines,
+           grid.max_x + 1, grid.max_y + 1, max_threads);
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+    fill_in_grid_with_non_diagonal_lines(&grid, lines, num_lines);
+    expected_part_1 = grid.num_intersecting;
+    fill_in_grid_with_diagonal_lines(&grid, lines, num_lines);
+    expected_part_2 = grid.num_intersecting;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+    print_elapsed_time(find_elapsed_time_ns(start_time, end_time), "Serial");
+
+    for (num_threads = 1; num_threads <= max_threads; num_threads++) {
+        clear_grid(&grid);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+        rasterise_lines_parallel(&grid, lines, num_lines, NON_DIAGONAL_LINES,
+                                 num_threads);
+        assert(grid.num_intersecting == expected_part_1);
+        rasterise_lines_parallel(&grid, lines, num_lines, DIAGONAL_LINES,
+                                 num_threads);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+        assert(grid.num_intersecting == expected_part_2);
+        snprintf(description, sizeof(description), "Parallel, %zu threads",
+                 num_threads);
+        print_elapsed_time(find_elapsed_time_ns(start_time, end_time),
+                           description);
+
+        clear_grid(&grid);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+        rasterise_lines_parallel(&grid, lines, num_lines, ALL_LINES,
+                                 num_threads);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+        assert(grid.num_intersecting == expected_part_2);
+        snprintf(description, sizeof(description),
+                 "Parallel one pass, %zu threads", num_threads);
+        print_elapsed_time(find_elapsed_time_ns(start_time, end_time),
+                           description);
+    }
+
+    free_grid(&grid);
+    free(lines);
+    lines = NULL;
+}
+
+/*
+ * pick_line_end
+ *
+ * Pick the end coordinate of a line from its start, moving up to length
+ * positions in a random direction and staying on the board. The end always
+ * differs from the start.
+ *
+ * Argument: start
+ *     Start coordinate.
+ * Argument: length
+ *     Most positions to move.
+ * Argument: size
+ *     Number of positions on each side of the board. Must be at least 2.
+ *
+ * Return: uint32_t
+ */
+static uint32_t
+pick_line_end(uint32_t start, uint32_t length, uint32_t size)
+{
+    bool increasing = rand() % 2;
+
+    if (start == 0) {
+        increasing = true;
+    } else if (start == size - 1) {
+        increasing = false;
+    }
+
+    return (increasing ? start + MIN(length, size - 1 - start)
+                       : start - MIN(length, start));
+}
+
+/*
+ * print_generated_lines
+ *
+ * Print randomly generated horizontal, vertical and diagonal lines in the
+ * puzzle's input format. The same arguments always give the same lines.
+ *
+ * Argument: num_lines
+ *     Number of lines to print.
+ * Argument: size
+ *     Number of positions on each side of the square board.
+ * Argument: max_length
+ *     Most positions each line moves from its start.
+ *
+ * Return: void
+ */
+static void
+print_generated_lines(size_t num_lines, uint32_t size, uint32_t max_length)
+{
+    line_type line;
+    uint32_t  length;
+    size_t    i;
+
+    assert(size >= 2 && max_length >= 1);
+    srand(num_lines);
+
+    for (i = 0; i < num_lines; i++) {
+        line.x_start = rand() % size;
+        line.y_start = rand() % size;
+        length = 1 + rand() % max_length;
+        switch (rand() % 3) {
+        case 0:
+            // Horizontal line.
+            line.x_end = pick_line_end(line.x_start, length, size);
+            line.y_end = line.y_start;
+            break;
+        case 1:
+            // Vertical line.
+            line.x_end = line.x_start;
+            line.y_end = pick_line_end(line.y_start, length, size);
+            break;
+        default:
+            // Diagonal line, shortened to keep both ends on the board.
+            line.x_end = pick_line_end(line.x_start, length, size);
+            line.y_end = pick_line_end(line.y_start, length, size);
+            length = MIN(labs((int64_t) line.x_end - line.x_start),
+                         labs((int64_t) line.y_end - line.y_start));
+            line.x_end = line.x_end > line.x_start ? line.x_start + length
+                                                   : line.x_start - length;
+            line.y_end = line.y_end > line.y_start ? line.y_start + length
+                                                   : line.y_start - length;
+            break;
+        }
+        printf("%u,%u -> %u,%u\n", line.x_start, line.y_start,
+               line.x_end, line.y_end);
+    }
+}
+
 /*
  * runner
  *
@@ -273,34 +1327,49 @@ runner(char *file_name, bool print_output)
     grid_type         grid;
     line_type        *lines = NULL;
     size_t            num_intersecting;
-    uint16_t          i;
+    size_t            num_threads = 1;
 
     parsed_text = parse_file(file_name);
 
     parse_lines_and_make_grid(parsed_text, &grid, &lines);
 
-    fill_in_grid_with_non_diagonal_lines(grid, lines, parsed_text.num_lines);
-    num_intersecting = find_number_of_intersecting_lines(grid);
+    if (grid.hit_once != NULL) {
+        num_threads = find_num_threads(
+                            find_num_positions_to_draw(lines,
+                                                       parsed_text.num_lines),
+                            MIN_POSITIONS_PER_THREAD);
+        rasterise_lines_parallel(&grid, lines, parsed_text.num_lines,
+                                 NON_DIAGONAL_LINES,
+                                 num_threads);
+        num_intersecting = grid.num_intersecting;
+    } else {
+        num_intersecting = sweep_number_of_intersecting_lines(
+                                                         lines,
+                                                         parsed_text.num_lines,
+                                                         false);
+    }
     if (print_output) {
         printf("Part 1: Number of intersecting lines = %zu\n",
                num_intersecting);
     }
 
-    fill_in_grid_with_diagonal_lines(grid, lines, parsed_text.num_lines);
-    num_intersecting = find_number_of_intersecting_lines(grid);
+    if (grid.hit_once != NULL) {
+        rasterise_lines_parallel(&grid, lines, parsed_text.num_lines,
+                                 DIAGONAL_LINES,
+                                 num_threads);
+        num_intersecting = grid.num_intersecting;
+    } else {
+        num_intersecting = sweep_number_of_intersecting_lines(
+                                                         lines,
+                                                         parsed_text.num_lines,
+                                                         true);
+    }
     if (print_output) {
         printf("Part 2: Number of intersecting lines = %zu\n",
                num_intersecting);
     }
 
-    if (grid.columns != NULL) {
-        for (i = 0; i <= grid.max_x; i++) {
-            free(grid.columns[i]);
-            grid.columns[i] = NULL;
-        }
-        free(grid.columns);
-        grid.columns = NULL;
-    }
+    free_grid(&grid);
     free(lines);
     lines = NULL;
 
@@ -309,12 +1378,32 @@ runner(char *file_name, bool print_output)
 
 /*
  * Main function.
+ *
+ * Usage:
+ *   day_05 <file>
+ *       Solve both parts.
+ *   day_05 --scaling <file>
+ *       Time the serial and parallel rasterisers for 1 to all cores.
+ *   day_05 --generate <num_lines> <size> <max_length>
+ *       Print random lines on a size x size board, each moving at most
+ *       max_length positions.
  */
 int
 main(int argc, char **argv)
 {
     char *file_name = NULL;
 
+    if (argc == 3 && STRS_EQUAL(argv[1], "--scaling")) {
+        report_scaling(argv[2]);
+        return (0);
+    }
+    if (argc == 5 && STRS_EQUAL(argv[1], "--generate")) {
+        print_generated_lines(strtoul(argv[2], NULL, 10),
+                              strtoul(argv[3], NULL, 10),
+                              strtoul(argv[4], NULL, 10));
+        return (0);
+    }
+
     assert(argc == 2);
     file_name = argv[1];
 
@@ -4,64 +4,314 @@
 
 #include "utils.h"
 
+/* Timers for the lanternfish species in the puzzle */
+#define LANTERNFISH_RESET_TIMER 6
+#define LANTERNFISH_SPAWN_TIMER 8
+
+/* Maximum number of repeated squaring powers needed for any size_t day */
+#define MAX_NUM_DAY_POWERS (sizeof(size_t) * 8)
+
+/*
+ * Polynomials with at most this many coefficients are multiplied directly,
+ * larger ones with Karatsuba.
+ */
+#define KARATSUBA_THRESHOLD 32
+
+/* Buffer size needed to print an unsigned 128-bit integer in decimal */
+#define FISH_COUNT_STR_SIZE 40
+
 /*
- * Number of unique fish states, starting from 0 going up to NUM_FISH_STATES-1
+ * fish_count_type
+ *
+ * Number of fish in a state. 128-bit so counts do not overflow for far longer
+ * than a size_t would. When a modulus is in use, counts are kept reduced by it.
  */
-#define NUM_FISH_STATES 9
+typedef unsigned __int128 fish_count_type;
+
+/*
+ * fish_species_type
+ *
+ * Element: reset_timer
+ *     Timer a fish goes back to after spawning.
+ * Element: spawn_timer
+ *     Timer a newly spawned fish starts on.
+ */
+typedef struct Fish_Species {
+    size_t reset_timer;
+    size_t spawn_timer;
+} fish_species_type;
 
 /*
  * fish_status_type
  *
  * Element: fish_states
- *     Array of fish statuses. There are NUM_FISH_STATES elements where each
- *     element is the number of fish currently in that state.
+ *     Array of fish statuses, where each element is the number of fish
+ *     currently on that timer.
+ * Element: num_states
+ *     Number of elements in fish_states. This is the order of the species
+ *     (one more than its largest timer).
  */
 typedef struct Fish_Status {
-    size_t fish_states[NUM_FISH_STATES];
+    fish_count_type *fish_states;
+    size_t           num_states;
 } fish_status_type;
 
 /*
- * initialise_fish_status_type
+ * fish_powers_type
  *
- * Set the values of a fish_status struct to their initial values (0).
+ * With k = num_states, the total number of fish P(n) after n days follows the
+ * linear recurrence
+ *     P(n) = P(n - reset_timer - 1) + P(n - spawn_timer - 1)
+ * for n >= k, whose characteristic polynomial is
+ *     x^k - x^(k - reset_timer - 1) - x^(k - spawn_timer - 1).
+ * P(n) is then sum(c_i * P(i)) where c_i are the coefficients of x^n reduced
+ * by the characteristic polynomial.
  *
- * Argument: fish_status
- *     Fish status struct to initiliase.
+ * Element: species
+ *     Species the powers are for.
+ * Element: num_states
+ *     Order of the recurrence.
+ * Element: powers
+ *     Array of num_powers polynomials, each of num_states coefficients, where
+ *     polynomial i is x^(2^i) reduced by the characteristic polynomial.
+ * Element: num_powers
+ *     Number of polynomials in the powers array.
+ * Element: modulus
+ *     Modulus all arithmetic is done in. 0 means no modulus, in which case
+ *     arithmetic wraps at 2^128.
+ */
+typedef struct Fish_Powers {
+    fish_species_type  species;
+    size_t             num_states;
+    fish_count_type   *powers;
+    size_t             num_powers;
+    fish_count_type    modulus;
+} fish_powers_type;
+
+/*
+ * fish_poly_workspace_type
  *
- * Return: void
+ * Scratch memory for multiplying and reducing polynomials, allocated once so
+ * no allocation is done per multiplication.
+ *
+ * Element: product
+ *     Array of 2 * num_states coefficients to hold an unreduced product.
+ * Element: scratch
+ *     Scratch array for Karatsuba multiplication.
  */
-static void
-initialise_fish_status_type(fish_status_type *fish_status)
+typedef struct Fish_Poly_Workspace {
+    fish_count_type *product;
+    fish_count_type *scratch;
+} fish_poly_workspace_type;
+
+/*
+ * add_fish_counts
+ *
+ * Add two fish counts in the given modulus. Both counts must already be
+ * reduced by the modulus.
+ *
+ * Argument: a
+ *     First count.
+ * Argument: b
+ *     Second count.
+ * Argument: modulus
+ *     Modulus to add in, or 0 for no modulus.
+ *
+ * Return: fish_count_type
+ */
+static fish_count_type
+add_fish_counts(fish_count_type a, fish_count_type b, fish_count_type modulus)
 {
+    fish_count_type sum;
+
+    sum = a + b;
+    if (modulus != 0 && (sum < a || sum >= modulus)) {
+        /* Wrapping here also undoes any overflow past 2^128 */
+        sum -= modulus;
+    }
+
+    return (sum);
+}
+
+/*
+ * subtract_fish_counts
+ *
+ * Subtract one fish count from another in the given modulus. Both counts must
+ * already be reduced by the modulus.
+ *
+ * Argument: a
+ *     Count to subtract from.
+ * Argument: b
+ *     Count to subtract.
+ * Argument: modulus
+ *     Modulus to subtract in, or 0 for no modulus.
+ *
+ * Return: fish_count_type
+ */
+static fish_count_type
+subtract_fish_counts(fish_count_type a,
+                     fish_count_type b,
+                     fish_count_type modulus)
+{
+    if (modulus != 0 && a < b) {
+        return (a + (modulus - b));
+    }
+
+    return (a - b);
+}
+
+/*
+ * multiply_fish_counts
+ *
+ * Multiply two fish counts in the given modulus. Both counts must already be
+ * reduced by the modulus.
+ *
+ * Argument: a
+ *     First count.
+ * Argument: b
+ *     Second count.
+ * Argument: modulus
+ *     Modulus to multiply in, or 0 for no modulus.
+ *
+ * Return: fish_count_type
+ */
+static fish_count_type
+multiply_fish_counts(fish_count_type a,
+                     fish_count_type b,
+                     fish_count_type modulus)
+{
+    fish_count_type product;
+
+    if (modulus == 0) {
+        return (a * b);
+    }
+
+    if ((a >> 64) == 0 && (b >> 64) == 0) {
+        /* Product fits in 128 bits so can be reduced directly */
+        return ((a * b) % modulus);
+    }
+
+    /*
+     * Modulus is larger than 64 bits, so the product could overflow. Fall back
+     * to double-and-add, which never exceeds 2 * modulus.
+     */
+    product = 0;
+    while (b > 0) {
+        if (b & 1) {
+            product = add_fish_counts(product, a, modulus);
+        }
+        a = add_fish_counts(a, a, modulus);
+        b >>= 1;
+    }
+
+    return (product);
+}
+
+/*
+ * fish_count_to_str
+ *
+ * Write a fish count as a decimal string.
+ *
+ * Argument: count
+ *     Count to convert.
+ * Argument: str
+ *     Buffer of at least FISH_COUNT_STR_SIZE bytes to write into.
+ *
+ * Return: char *
+ *     Pointer to str.
+ */
+static char *
+fish_count_to_str(fish_count_type count, char *str)
+{
+    char   reversed[FISH_COUNT_STR_SIZE];
+    size_t len = 0;
     size_t i;
 
-    for (i = 0; i < NUM_FISH_STATES; i++) {
-        fish_status->fish_states[i] = 0;
+    do {
+        reversed[len++] = '0' + (char) (count % 10);
+        count /= 10;
+    } while (count > 0);
+
+    for (i = 0; i < len; i++) {
+        str[i] = reversed[len - i - 1];
     }
+    str[len] = '\0';
+
+    return (str);
+}
+
+/*
+ * parse_fish_count
+ *
+ * Parse a decimal string into a fish count, so counts too large for 64 bits
+ * can be given.
+ *
+ * Argument: str
+ *     Decimal string to parse.
+ *
+ * Return: fish_count_type
+ */
+static fish_count_type
+parse_fish_count(char *str)
+{
+    fish_count_type count = 0;
+    char           *pos = NULL;
+
+    assert(*str != '\0');
+    for (pos = str; *pos != '\0'; pos++) {
+        assert(*pos >= '0' && *pos <= '9');
+        count = count * 10 + (*pos - '0');
+    }
+
+    return (count);
+}
+
+/*
+ * find_number_of_fish_states
+ *
+ * Find the number of timer values a fish of the species can have.
+ *
+ * Argument: species
+ *     Fish species.
+ *
+ * Return: size_t
+ */
+static size_t
+find_number_of_fish_states(fish_species_type species)
+{
+    return (MAX(species.reset_timer, species.spawn_timer) + 1);
 }
 
 /*
  * parse_line_into_fish_status
  *
- * Parse a line of comma-separated fish values into a fish_status struct.
+ * Parse a line of comma-separated fish values into a fish_status struct. The
+ * returned struct must be freed with free_fish_status().
  *
  * Argument: line
  *     Comma separated initial values of fish.
+ * Argument: species
+ *     Species of the fish.
  *
  * Return: fish_status_type
  */
 static fish_status_type
-parse_line_into_fish_status(char *line)
+parse_line_into_fish_status(char *line, fish_species_type species)
 {
     fish_status_type  fish_status;
     parsed_text_type  split_text;
+    size_t            state;
     size_t            i;
 
     split_text = split_string_on_char(line, ',');
 
-    initialise_fish_status_type(&fish_status);
+    fish_status.num_states = find_number_of_fish_states(species);
+    fish_status.fish_states = calloc_b(fish_status.num_states,
+                                       sizeof(fish_count_type));
     for (i = 0; i < split_text.num_lines; i++) {
-        fish_status.fish_states[atol(split_text.lines[i].line)]++;
+        state = atol(split_text.lines[i].line);
+        assert(state < fish_status.num_states);
+        fish_status.fish_states[state]++;
     }
 
     free_parsed_text(split_text);
@@ -70,59 +320,531 @@ parse_line_into_fish_status(char *line)
 }
 
 /*
- * iterate_day
+ * free_fish_status
+ *
+ * Free allocated memory from the fish_status struct.
+ *
+ * Argument: fish_status
+ *     fish_status_type struct to free.
+ *
+ * Return: void
+ */
+static void
+free_fish_status(fish_status_type *fish_status)
+{
+    free(fish_status->fish_states);
+    fish_status->fish_states = NULL;
+    fish_status->num_states = 0;
+}
+
+/*
+ * calculate_initial_terms
  *
- * Calculate and set the fish status after the next day according to the
- * following rules:
- *   1. If a fish is currently on 0, reset to 6 and spawn a new fish. Newly
- *      spawned fish have a value of 8.
- *   2. If a fish is not on 0, decrease it by 1.
+ * Simulate day by day to find the total number of fish for days 0 to
+ * num_states-1, which seed the recurrence. Each day is O(1) by rotating the
+ * timers in a ring buffer instead of moving every fish.
  *
  * Argument: fish_status
- *     Fish status struct to iterate.
+ *     Initial fish status.
+ * Argument: species
+ *     Species of the fish.
+ * Argument: modulus
+ *     Modulus to add in, or 0 for no modulus.
+ * Argument: ring
+ *     Scratch array of num_states elements.
+ * Argument: initial_terms
+ *     Array of num_states elements to write the number of fish into.
+ *
+ * Return: void
+ */
+static void
+calculate_initial_terms(fish_status_type  fish_status,
+                        fish_species_type species,
+                        fish_count_type   modulus,
+                        fish_count_type  *ring,
+                        fish_count_type  *initial_terms)
+{
+    fish_count_type num_fish = 0;
+    fish_count_type num_spawning;
+    size_t          num_states = fish_status.num_states;
+    size_t          head;
+    size_t          day;
+    size_t          i;
+
+    for (i = 0; i < num_states; i++) {
+        ring[i] = fish_status.fish_states[i];
+        if (modulus != 0) {
+            ring[i] %= modulus;
+        }
+        num_fish = add_fish_counts(num_fish, ring[i], modulus);
+    }
+
+    /* ring[(head + t) % num_states] is the number of fish on timer t */
+    head = 0;
+    initial_terms[0] = num_fish;
+    for (day = 1; day < num_states; day++) {
+        num_spawning = ring[head];
+        ring[head] = 0;
+        head = (head + 1) % num_states;
+
+        i = (head + species.reset_timer) % num_states;
+        ring[i] = add_fish_counts(ring[i], num_spawning, modulus);
+        i = (head + species.spawn_timer) % num_states;
+        ring[i] = add_fish_counts(ring[i], num_spawning, modulus);
+
+        num_fish = add_fish_counts(num_fish, num_spawning, modulus);
+        initial_terms[day] = num_fish;
+    }
+}
+
+/*
+ * multiply_fish_polys
+ *
+ * Multiply two polynomials of len coefficients, writing the 2 * len
+ * coefficients of the product into result. Uses Karatsuba above
+ * KARATSUBA_THRESHOLD coefficients, which works in any modulus.
+ *
+ * Argument: a
+ *     First polynomial.
+ * Argument: b
+ *     Second polynomial.
+ * Argument: len
+ *     Number of coefficients in a and b.
+ * Argument: modulus
+ *     Modulus to multiply in, or 0 for no modulus.
+ * Argument: result
+ *     Array of 2 * len elements to write the product into.
+ * Argument: scratch
+ *     Scratch array of at least 4 * (len + MAX_NUM_DAY_POWERS) elements.
+ *
+ * Return: void
+ */
+static void
+multiply_fish_polys(fish_count_type *a,
+                    fish_count_type *b,
+                    size_t           len,
+                    fish_count_type  modulus,
+                    fish_count_type *result,
+                    fish_count_type *scratch)
+{
+    fish_count_type *a_sum = NULL;
+    fish_count_type *b_sum = NULL;
+    fish_count_type *middle = NULL;
+    size_t           low, high;
+    size_t           i, j;
+
+    if (len <= KARATSUBA_THRESHOLD) {
+        for (i = 0; i < 2 * len; i++) {
+            result[i] = 0;
+        }
+        for (i = 0; i < len; i++) {
+            if (a[i] == 0) {
+                continue;
+            }
+            for (j = 0; j < len; j++) {
+                result[i+j] = add_fish_counts(
+                                 result[i+j],
+                                 multiply_fish_counts(a[i], b[j], modulus),
+                                 modulus);
+            }
+        }
+        return;
+    }
+
+    /*
+     * Split a = a_low + x^low * a_high (and the same for b), then
+     *   a * b = low_product + x^low * middle + x^(2 * low) * high_product
+     * where middle = (a_low + a_high)(b_low + b_high) - low_product
+     *                - high_product.
+     */
+    low = len / 2;
+    high = len - low;
+
+    multiply_fish_polys(a, b, low, modulus, result, scratch);
+    multiply_fish_polys(a + low, b + low, high, modulus, result + 2 * low,
+                        scratch);
+
+    a_sum = scratch;
+    b_sum = scratch + high;
+    middle = scratch + 2 * high;
+    for (i = 0; i < high; i++) {
+        a_sum[i] = a[low + i];
+        b_sum[i] = b[low + i];
+        if (i < low) {
+            a_sum[i] = add_fish_counts(a_sum[i], a[i], modulus);
+            b_sum[i] = add_fish_counts(b_sum[i], b[i], modulus);
+        }
+    }
+    multiply_fish_polys(a_sum, b_sum, high, modulus, middle,
+                        scratch + 4 * high);
+
+    for (i = 0; i < 2 * low; i++) {
+        middle[i] = subtract_fish_counts(middle[i], result[i], modulus);
+    }
+    for (i = 0; i < 2 * high; i++) {
+        middle[i] = subtract_fish_counts(middle[i], result[2 * low + i],
+                                         modulus);
+    }
+    for (i = 0; i < 2 * high; i++) {
+        result[low + i] = add_fish_counts(result[low + i], middle[i],
+                                          modulus);
+    }
+}
+
+/*
+ * reduce_fish_poly
+ *
+ * Reduce a polynomial of 2 * num_states coefficients by the characteristic
+ * polynomial, in place. Because the characteristic polynomial only has three
+ * terms this is O(num_states), using
+ *     x^d = x^(d - reset_timer - 1) + x^(d - spawn_timer - 1)
+ * from the highest degree down.
+ *
+ * Argument: fish_powers
+ *     Powers struct holding the species and modulus.
+ * Argument: poly
+ *     Polynomial to reduce. The first num_states coefficients hold the result.
  *
  * Return: void
  */
 static void
-iterate_day(fish_status_type *fish_status)
-{
-    size_t           i;
-    fish_status_type new_fish_status;
-
-    initialise_fish_status_type(&new_fish_status);
-    for (i = 0; i < NUM_FISH_STATES; i++) {
-        if (i == 0) {
-            new_fish_status.fish_states[6] += fish_status->fish_states[0];
-            new_fish_status.fish_states[8] += fish_status->fish_states[0];
-        } else {
-            new_fish_status.fish_states[i-1] += fish_status->fish_states[i];
+reduce_fish_poly(fish_powers_type *fish_powers, fish_count_type *poly)
+{
+    size_t          reset_period = fish_powers->species.reset_timer + 1;
+    size_t          spawn_period = fish_powers->species.spawn_timer + 1;
+    fish_count_type coefficient;
+    size_t          d;
+
+    for (d = 2 * fish_powers->num_states - 1; d >= fish_powers->num_states;
+         d--) {
+        coefficient = poly[d];
+        if (coefficient == 0) {
+            continue;
         }
+        poly[d] = 0;
+        poly[d - reset_period] = add_fish_counts(poly[d - reset_period],
+                                                 coefficient,
+                                                 fish_powers->modulus);
+        poly[d - spawn_period] = add_fish_counts(poly[d - spawn_period],
+                                                 coefficient,
+                                                 fish_powers->modulus);
     }
+}
 
-    *fish_status = new_fish_status;
+/*
+ * multiply_and_reduce_fish_polys
+ *
+ * Multiply two reduced polynomials and reduce the product by the
+ * characteristic polynomial.
+ *
+ * Argument: fish_powers
+ *     Powers struct holding the species and modulus.
+ * Argument: a
+ *     First polynomial.
+ * Argument: b
+ *     Second polynomial.
+ * Argument: workspace
+ *     Scratch memory to use.
+ * Argument: result
+ *     Array of num_states elements to write the result into. May be a or b.
+ *
+ * Return: void
+ */
+static void
+multiply_and_reduce_fish_polys(fish_powers_type         *fish_powers,
+                               fish_count_type          *a,
+                               fish_count_type          *b,
+                               fish_poly_workspace_type *workspace,
+                               fish_count_type          *result)
+{
+    multiply_fish_polys(a, b, fish_powers->num_states, fish_powers->modulus,
+                        workspace->product, workspace->scratch);
+    reduce_fish_poly(fish_powers, workspace->product);
+    memcpy(result, workspace->product,
+           fish_powers->num_states * sizeof(fish_count_type));
 }
 
 /*
- * calculate_number_of_fish
+ * make_fish_poly_workspace
+ *
+ * Allocate scratch memory for polynomials of num_states coefficients. The
+ * returned struct must be freed with free_fish_poly_workspace().
  *
- * Calculate the number of current fish.
+ * Argument: num_states
+ *     Number of coefficients in each reduced polynomial.
  *
+ * Return: fish_poly_workspace_type
+ */
+static fish_poly_workspace_type
+make_fish_poly_workspace(size_t num_states)
+{
+    fish_poly_workspace_type workspace;
+
+    workspace.product = malloc_b(2 * num_states * sizeof(fish_count_type));
+    workspace.scratch = malloc_b(4 * (num_states + MAX_NUM_DAY_POWERS) *
+                                 sizeof(fish_count_type));
+
+    return (workspace);
+}
+
+/*
+ * free_fish_poly_workspace
+ *
+ * Free allocated memory from the fish_poly_workspace struct.
+ *
+ * Argument: workspace
+ *     fish_poly_workspace_type struct to free.
+ *
+ * Return: void
+ */
+static void
+free_fish_poly_workspace(fish_poly_workspace_type *workspace)
+{
+    free(workspace->product);
+    workspace->product = NULL;
+    free(workspace->scratch);
+    workspace->scratch = NULL;
+}
+
+/*
+ * make_fish_powers
+ *
+ * Precompute x^(2^i) reduced by the species' characteristic polynomial for
+ * every power of 2 needed to reach max_days. The returned struct must be freed
+ * with free_fish_powers().
+ *
+ * Argument: species
+ *     Fish species.
+ * Argument: max_days
+ *     Largest number of days that will be queried.
+ * Argument: modulus
+ *     Modulus to do all arithmetic in, or 0 for no modulus.
+ *
+ * Return: fish_powers_type
+ */
+static fish_powers_type
+make_fish_powers(fish_species_type species,
+                 size_t            max_days,
+                 fish_count_type   modulus)
+{
+    fish_powers_type          fish_powers;
+    fish_poly_workspace_type  workspace;
+    size_t                    num_states;
+    size_t                    i;
+
+    num_states = find_number_of_fish_states(species);
+
+    fish_powers.species = species;
+    fish_powers.num_states = num_states;
+    fish_powers.modulus = modulus;
+    fish_powers.num_powers = 1;
+    while (fish_powers.num_powers < MAX_NUM_DAY_POWERS &&
+           (max_days >> fish_powers.num_powers) > 0) {
+        fish_powers.num_powers++;
+    }
+
+    fish_powers.powers = malloc_b(fish_powers.num_powers * num_states *
+                                  sizeof(fish_count_type));
+    workspace = make_fish_poly_workspace(num_states);
+
+    /* x^1, which needs reducing if there is only one state */
+    for (i = 0; i < 2 * num_states; i++) {
+        workspace.product[i] = 0;
+    }
+    workspace.product[1] = (modulus == 1) ? 0 : 1;
+    reduce_fish_poly(&fish_powers, workspace.product);
+    memcpy(fish_powers.powers, workspace.product,
+           num_states * sizeof(fish_count_type));
+
+    for (i = 1; i < fish_powers.num_powers; i++) {
+        multiply_and_reduce_fish_polys(
+                                &fish_powers,
+                                &fish_powers.powers[(i - 1) * num_states],
+                                &fish_powers.powers[(i - 1) * num_states],
+                                &workspace,
+                                &fish_powers.powers[i * num_states]);
+    }
+
+    free_fish_poly_workspace(&workspace);
+
+    return (fish_powers);
+}
+
+/*
+ * free_fish_powers
+ *
+ * Free allocated memory from the fish_powers struct.
+ *
+ * Argument: fish_powers
+ *     fish_powers_type struct to free.
+ *
+ * Return: void
+ */
+static void
+free_fish_powers(fish_powers_type *fish_powers)
+{
+    free(fish_powers->powers);
+    fish_powers->powers = NULL;
+    fish_powers->num_powers = 0;
+}
+
+/*
+ * calculate_number_of_fish_after_days_batch
+ *
+ * Calculate the number of fish after each number of days in days_array,
+ * starting from the same initial fish status. Every query shares the
+ * precomputed powers, so each only costs one polynomial multiplication per set
+ * bit of its day count.
+ *
+ * Argument: fish_powers
+ *     Precomputed powers, covering at least the largest day in days_array.
  * Argument: fish_status
- *     Fish status struct.
+ *     Initial fish status, of the same species as fish_powers.
+ * Argument: days_array
+ *     Array of the number of days to calculate the number of fish after.
+ * Argument: num_queries
+ *     Number of elements in days_array.
+ * Argument: num_fish_array
+ *     Array of num_queries elements to write the number of fish into.
  *
- * Return: size_t
+ * Return: void
  */
-static size_t
-calculate_number_of_fish(fish_status_type fish_status)
+static void
+calculate_number_of_fish_after_days_batch(fish_powers_type *fish_powers,
+                                          fish_status_type  fish_status,
+                                          size_t           *days_array,
+                                          size_t            num_queries,
+                                          fish_count_type  *num_fish_array)
 {
-    size_t num_fish = 0;
-    size_t i;
+    fish_poly_workspace_type  workspace;
+    fish_count_type          *initial_terms = NULL;
+    fish_count_type          *poly = NULL;
+    fish_count_type           num_fish;
+    size_t                    num_states = fish_powers->num_states;
+    size_t                    days;
+    bool                      is_first_power;
+    size_t                    i, j;
+
+    assert(fish_status.num_states == num_states);
+
+    workspace = make_fish_poly_workspace(num_states);
+    initial_terms = malloc_b(num_states * sizeof(fish_count_type));
+    poly = malloc_b(num_states * sizeof(fish_count_type));
+
+    /* Poly is used as the ring buffer here before holding polynomials */
+    calculate_initial_terms(fish_status, fish_powers->species,
+                            fish_powers->modulus, poly, initial_terms);
+
+    for (i = 0; i < num_queries; i++) {
+        days = days_array[i];
+        if (days < num_states) {
+            num_fish_array[i] = initial_terms[days];
+            continue;
+        }
+
+        /* Find x^days reduced by the characteristic polynomial */
+        is_first_power = true;
+        for (j = 0; days > 0; j++, days >>= 1) {
+            assert(j < fish_powers->num_powers);
+            if (!(days & 1)) {
+                continue;
+            }
+            if (is_first_power) {
+                memcpy(poly, &fish_powers->powers[j * num_states],
+                       num_states * sizeof(fish_count_type));
+                is_first_power = false;
+            } else {
+                multiply_and_reduce_fish_polys(
+                                        fish_powers,
+                                        poly,
+                                        &fish_powers->powers[j * num_states],
+                                        &workspace,
+                                        poly);
+            }
+        }
 
-    for (i = 0; i < NUM_FISH_STATES; i++) {
-        num_fish += fish_status.fish_states[i];
+        num_fish = 0;
+        for (j = 0; j < num_states; j++) {
+            num_fish = add_fish_counts(
+                            num_fish,
+                            multiply_fish_counts(poly[j], initial_terms[j],
+                                                 fish_powers->modulus),
+                            fish_powers->modulus);
+        }
+        num_fish_array[i] = num_fish;
     }
 
-    return (num_fish);
+    free(poly);
+    poly = NULL;
+    free(initial_terms);
+    initial_terms = NULL;
+    free_fish_poly_workspace(&workspace);
+}
+
+/*
+ * print_number_of_fish_after_days
+ *
+ * Print the number of fish of a species after each of the given numbers of
+ * days, all found from one set of powers covering the largest.
+ *
+ * Argument: file_name
+ *     File to read the initial fish from.
+ * Argument: species
+ *     Species of the fish.
+ * Argument: modulus_str
+ *     Decimal modulus to count in, or 0 for no modulus.
+ * Argument: days_strs
+ *     Array of decimal numbers of days.
+ * Argument: num_queries
+ *     Number of elements in days_strs.
+ *
+ * Return: void
+ */
+static void
+print_number_of_fish_after_days(char               *file_name,
+                                fish_species_type   species,
+                                char               *modulus_str,
+                                char              **days_strs,
+                                size_t              num_queries)
+{
+    parsed_text_type   parsed_text;
+    fish_status_type   fish_status;
+    fish_powers_type   fish_powers;
+    fish_count_type    modulus;
+    size_t            *days_array = NULL;
+    fish_count_type   *num_fish_array = NULL;
+    size_t             max_days = 0;
+    char               num_fish_str[FISH_COUNT_STR_SIZE];
+    size_t             i;
+
+    modulus = parse_fish_count(modulus_str);
+    days_array = malloc_b(num_queries * sizeof(size_t));
+    num_fish_array = malloc_b(num_queries * sizeof(fish_count_type));
+    for (i = 0; i < num_queries; i++) {
+        days_array[i] = strtoull(days_strs[i], NULL, 10);
+        max_days = MAX(max_days, days_array[i]);
+    }
+
+    parsed_text = parse_file(file_name);
+    fish_status = parse_line_into_fish_status(parsed_text.lines[0].line,
+                                              species);
+
+    fish_powers = make_fish_powers(species, max_days, modulus);
+    calculate_number_of_fish_after_days_batch(&fish_powers, fish_status,
+                                              days_array, num_queries,
+                                              num_fish_array);
+    for (i = 0; i < num_queries; i++) {
+        printf("Number of fish after %zu days = %s\n", days_array[i],
+               fish_count_to_str(num_fish_array[i], num_fish_str));
+    }
+
+    free_fish_powers(&fish_powers);
+    free_fish_status(&fish_status);
+    free_parsed_text(parsed_text);
+    free(num_fish_array);
+    num_fish_array = NULL;
+    free(days_array);
+    days_array = NULL;
 }
 
 /*
@@ -142,39 +864,59 @@ static void
 runner(char *file_name, bool print_output)
 {
     parsed_text_type  parsed_text;
+    fish_species_type species = {LANTERNFISH_RESET_TIMER,
+                                 LANTERNFISH_SPAWN_TIMER};
     fish_status_type  fish_status;
-    size_t            day;
+    fish_powers_type  fish_powers;
+    size_t            days_array[2] = {80, 256};
+    fish_count_type   num_fish_array[2];
+    char              num_fish_str[FISH_COUNT_STR_SIZE];
 
     parsed_text = parse_file(file_name);
 
-    fish_status = parse_line_into_fish_status(parsed_text.lines[0].line);
-
-    for (day = 0; day < 80; day++) {
-        iterate_day(&fish_status);
-    }
-    if (print_output) {
-        printf("Part 1: Number of fish after %zu days = %zu\n",
-            day, calculate_number_of_fish(fish_status));
-    }
+    fish_status = parse_line_into_fish_status(parsed_text.lines[0].line,
+                                              species);
 
-    for (; day < 256; day++) {
-        iterate_day(&fish_status);
-    }
+    fish_powers = make_fish_powers(species, days_array[1], 0);
+    calculate_number_of_fish_after_days_batch(&fish_powers, fish_status,
+                                              days_array, 2, num_fish_array);
     if (print_output) {
-        printf("Part 1: Number of fish after %zu days = %zu\n",
-           day, calculate_number_of_fish(fish_status));
+        printf("Part 1: Number of fish after %zu days = %s\n",
+               days_array[0], fish_count_to_str(num_fish_array[0],
+                                                num_fish_str));
+        printf("Part 2: Number of fish after %zu days = %s\n",
+               days_array[1], fish_count_to_str(num_fish_array[1],
+                                                num_fish_str));
     }
 
+    free_fish_powers(&fish_powers);
+    free_fish_status(&fish_status);
     free_parsed_text(parsed_text);
 }
 
 /*
  * Main function.
+ *
+ * Usage:
+ *   day_06 <file>
+ *       Solve both parts.
+ *   day_06 --days <file> <reset_timer> <spawn_timer> <modulus> <days> ...
+ *       Print the number of fish of a species with the given timers after
+ *       each number of days, modulo modulus unless it is 0.
  */
 int
 main(int argc, char **argv)
 {
-    char *file_name = NULL;
+    char              *file_name = NULL;
+    fish_species_type  species;
+
+    if (argc >= 7 && STRS_EQUAL(argv[1], "--days")) {
+        species.reset_timer = strtoul(argv[3], NULL, 10);
+        species.spawn_timer = strtoul(argv[4], NULL, 10);
+        print_number_of_fish_after_days(argv[2], species, argv[5], &argv[6],
+                                        argc - 6);
+        return (0);
+    }
 
     assert(argc == 2);
     file_name = argv[1];
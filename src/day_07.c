@@ -2,84 +2,637 @@
  * AoC 2021 Day 7 solution
  */
 
+#include <inttypes.h>
+
 #include "utils.h"
 
+/* Distance beyond which the capped linear cost stops increasing */
+#define CAPPED_LINEAR_COST_CAP 100
+
+/*
+ * crab_histogram_type
+ *
+ * All positions are stored relative to min_position, which keeps the sums
+ * small.
+ *
+ * Element: counts
+ *     Array of the number of crabs at each position.
+ * Element: num_positions
+ *     Number of elements in counts (max_position - min_position + 1).
+ * Element: min_position
+ *     Smallest crab position.
+ * Element: num_crabs
+ *     Total number of crabs.
+ * Element: position_sum
+ *     Sum of every crab's relative position.
+ * Element: position_squared_sum
+ *     Sum of every crab's relative position squared.
+ */
+typedef struct Crab_Histogram {
+    uint64_t *counts;
+    size_t    num_positions;
+    int64_t   min_position;
+    uint64_t  num_crabs;
+    uint64_t  position_sum;
+    uint64_t  position_squared_sum;
+} crab_histogram_type;
+
+/*
+ * crab_alignment_type
+ *
+ * Element: position
+ *     Position the crabs meet at.
+ * Element: fuel
+ *     Total fuel for all crabs to get to the position.
+ */
+typedef struct Crab_Alignment {
+    int64_t  position;
+    uint64_t fuel;
+} crab_alignment_type;
+
 /*
- * find_fuel_needed_part_1
+ * crab_cost_enum_type
  *
- * Find the fuel cost of all crabs moving to the middle position for part 1,
- * where the fuel cost is the difference from the middle position.
+ * Enum of the cost functions in crab_cost_functions.
+ */
+typedef enum Crab_Cost {
+    LINEAR_COST,
+    TRIANGULAR_COST,
+    QUADRATIC_COST,
+    CUBIC_COST,
+    CAPPED_LINEAR_COST,
+    NUM_CRAB_COSTS,
+} crab_cost_enum_type;
+
+/*
+ * crab_cost_function_type
  *
- * Argument: numbers_array
- *     Array of initial crab positions.
- * Argument: len
- *     Number of elements in the array.
- * Argument: meeting_position
- *     The position the crabs will go to which should cost the least amount of
- *     fuel (the median of the array).
+ * Element: name
+ *     Name of the cost function, as given to --curve.
+ * Element: cost
+ *     Function giving the fuel for one crab to move distance, given parameter.
+ * Element: parameter
+ *     Parameter passed to cost, e.g. a cap. Unused by some cost functions.
+ * Element: is_convex
+ *     Whether the cost is convex and non-decreasing in distance, which makes
+ *     the total fuel convex in the meeting position so the minimum can be
+ *     found by binary search.
+ * Element: linear_weight
+ *     See weight_shift.
+ * Element: squared_weight
+ *     See weight_shift.
+ * Element: weight_shift
+ *     If the cost of distance d is
+ *         (linear_weight * d + squared_weight * d^2) >> weight_shift
+ *     the total fuel at each position is found in O(1) from running sums of
+ *     the positions. Both weights are 0 for other costs.
+ */
+typedef struct Crab_Cost_Function {
+    char     *name;
+    uint64_t (*cost)(uint64_t distance, uint64_t parameter);
+    uint64_t  parameter;
+    bool      is_convex;
+    uint64_t  linear_weight;
+    uint64_t  squared_weight;
+    uint64_t  weight_shift;
+} crab_cost_function_type;
+
+/*
+ * linear_cost
  *
- * Return: int
+ * Fuel is the distance moved (part 1).
  */
-static int
-find_fuel_needed_part_1(int *numbers_array, size_t len, int meeting_position)
+static uint64_t
+linear_cost(uint64_t distance, uint64_t parameter)
 {
-    int    fuel = 0;
-    size_t i;
+    (void) parameter;
+
+    return (distance);
+}
+
+/*
+ * triangular_cost
+ *
+ * Fuel is the sum of all integers up to and including the distance moved
+ * (part 2).
+ */
+static uint64_t
+triangular_cost(uint64_t distance, uint64_t parameter)
+{
+    (void) parameter;
+
+    return (distance * (distance + 1) / 2);
+}
+
+/*
+ * quadratic_cost
+ *
+ * Fuel is the square of the distance moved.
+ */
+static uint64_t
+quadratic_cost(uint64_t distance, uint64_t parameter)
+{
+    (void) parameter;
+
+    return (distance * distance);
+}
+
+/*
+ * cubic_cost
+ *
+ * Fuel is the cube of the distance moved.
+ */
+static uint64_t
+cubic_cost(uint64_t distance, uint64_t parameter)
+{
+    (void) parameter;
+
+    return (distance * distance * distance);
+}
+
+/*
+ * capped_linear_cost
+ *
+ * Fuel is the distance moved, up to a maximum of parameter.
+ */
+static uint64_t
+capped_linear_cost(uint64_t distance, uint64_t parameter)
+{
+    (void) parameter;
+
+    return (MIN(distance, parameter));
+}
+
+/* Table of the available cost functions, indexed by crab_cost_enum_type */
+static const crab_cost_function_type crab_cost_functions[NUM_CRAB_COSTS] = {
+    [LINEAR_COST]        = {"linear", linear_cost, 0, true, 1, 0, 0},
+    [TRIANGULAR_COST]    = {"triangular", triangular_cost, 0, true, 1, 1, 1},
+    [QUADRATIC_COST]     = {"quadratic", quadratic_cost, 0, true, 0, 1, 0},
+    [CUBIC_COST]         = {"cubic", cubic_cost, 0, true, 0, 0, 0},
+    [CAPPED_LINEAR_COST] = {"capped_linear", capped_linear_cost,
+                            CAPPED_LINEAR_COST_CAP, false, 0, 0, 0},
+};
+
+/*
+ * parse_text_into_crab_histogram
+ *
+ * Parse comma-separated crab positions into a histogram. The text is read
+ * twice, once to find the range of positions and once to fill the counts, so
+ * no array of positions is needed. The returned struct must be freed with
+ * free_crab_histogram().
+ *
+ * Argument: text
+ *     Comma separated crab positions.
+ *
+ * Return: crab_histogram_type
+ */
+static crab_histogram_type
+parse_text_into_crab_histogram(char *text)
+{
+    crab_histogram_type  histogram;
+    char                *pos = NULL;
+    char                *end = NULL;
+    int64_t              position;
+    int64_t              max_position;
+    uint64_t             relative_position;
+
+    histogram.counts = NULL;
+    histogram.num_positions = 0;
+    histogram.min_position = INT64_MAX;
+    histogram.num_crabs = 0;
+    histogram.position_sum = 0;
+    histogram.position_squared_sum = 0;
+    max_position = INT64_MIN;
+
+    for (pos = text; *pos != '\0'; pos = end) {
+        position = strtoll(pos, &end, 10);
+        if (end == pos) {
+            /* Not a number, skip the separator */
+            end++;
+            continue;
+        }
+        histogram.min_position = MIN(histogram.min_position, position);
+        max_position = MAX(max_position, position);
+        histogram.num_crabs++;
+    }
+    assert(histogram.num_crabs > 0);
+
+    histogram.num_positions = max_position - histogram.min_position + 1;
+    histogram.counts = calloc_b(histogram.num_positions, sizeof(uint64_t));
+
+    for (pos = text; *pos != '\0'; pos = end) {
+        position = strtoll(pos, &end, 10);
+        if (end == pos) {
+            end++;
+            continue;
+        }
+        relative_position = position - histogram.min_position;
+        histogram.counts[relative_position]++;
+        histogram.position_sum += relative_position;
+        histogram.position_squared_sum += relative_position *
+                                          relative_position;
+    }
+
+    return (histogram);
+}
+
+/*
+ * free_crab_histogram
+ *
+ * Free allocated memory from the crab_histogram struct.
+ *
+ * Argument: histogram
+ *     crab_histogram_type struct to free.
+ *
+ * Return: void
+ */
+static void
+free_crab_histogram(crab_histogram_type *histogram)
+{
+    free(histogram->counts);
+    histogram->counts = NULL;
+    histogram->num_positions = 0;
+}
+
+/*
+ * make_cost_table
+ *
+ * Evaluate a cost function for every distance from 0 to num_positions, so
+ * the callback is only called once per distance. The memory of the returned
+ * array must be freed by the caller.
+ *
+ * Argument: histogram
+ *     Histogram of crab positions.
+ * Argument: cost_function
+ *     Cost function to evaluate.
+ *
+ * Return: uint64_t *
+ */
+static uint64_t *
+make_cost_table(crab_histogram_type            histogram,
+                const crab_cost_function_type *cost_function)
+{
+    uint64_t *cost_table = NULL;
+    size_t    d;
+
+    cost_table = malloc_b((histogram.num_positions + 1) * sizeof(uint64_t));
+    for (d = 0; d <= histogram.num_positions; d++) {
+        cost_table[d] = cost_function->cost(d, cost_function->parameter);
+    }
+
+    return (cost_table);
+}
 
-    for (i = 0; i < len; i++) {
-        fuel += abs(numbers_array[i] - meeting_position);
+/*
+ * find_fuel_at_position
+ *
+ * Find the total fuel for all crabs to move to a relative position.
+ *
+ * Argument: histogram
+ *     Histogram of crab positions.
+ * Argument: cost_table
+ *     Cost of each distance, from make_cost_table().
+ * Argument: t
+ *     Relative position to move to.
+ *
+ * Return: uint64_t
+ */
+static uint64_t
+find_fuel_at_position(crab_histogram_type  histogram,
+                      uint64_t            *cost_table,
+                      size_t               t)
+{
+    uint64_t fuel = 0;
+    size_t   d;
+
+    /* Crabs at and to the right of t, then those to the left */
+    for (d = 0; t + d < histogram.num_positions; d++) {
+        fuel += histogram.counts[t + d] * cost_table[d];
+    }
+    for (d = 1; d <= t; d++) {
+        fuel += histogram.counts[t - d] * cost_table[d];
     }
 
     return (fuel);
 }
 
 /*
- * find_fuel_needed_part_2
+ * fill_fuel_curve
+ *
+ * Find the total fuel for every relative meeting position in one sweep.
  *
- * Find the fuel cost of all crabs moving to the middle position for part 2,
- * where the fuel cost is the sum of all integers up to and including the
- * difference from the middle position.
+ * With g(x) = cost(|x|), the total fuel is the convolution
+ *     C(t) = sum_p counts[p] * g(t - p)
+ * so its second difference is the convolution of the counts with the second
+ * difference of g:
+ *     C(t-1) - 2C(t) + C(t+1) = sum_p counts[p] * g''(t - p).
+ * For the usual costs g'' is a constant plus a few spikes (e.g. linear is a
+ * single spike at 0, triangular is 1 plus a spike at 0, quadratic is 2), so
+ * the right hand side is built with one pass per spike, each a vectorisable
+ * multiply-add of the shifted counts. C is then recovered from C(0) and C(1).
+ * Any cost works, convex or not, but the more spikes the slower.
  *
- * Argument: numbers_array
- *     Array of initial crab positions.
- * Argument: len
- *     Number of elements in the array.
- * Argument: meeting_position
- *     The position the crabs will go to which should cost the least amount of
- *     fuel (the mean of the array). Crabs can only go to an integer, so this
- *     is rounded to the floor or ceil, depending on which gives the lower
- *     total fuel.
+ * Intermediate values may wrap, but unsigned 64-bit arithmetic is modular so
+ * the curve is exact as long as every total fits in 64 bits.
  *
- * Return: int
+ * Argument: histogram
+ *     Histogram of crab positions.
+ * Argument: cost_function
+ *     Cost function for one crab.
+ * Argument: curve
+ *     Array of num_positions elements to write the total fuel into.
+ *
+ * Return: void
  */
-static int
-find_fuel_needed_part_2(int *numbers_array,
-                        size_t len,
-                        double meeting_position)
+static void
+fill_fuel_curve(crab_histogram_type            histogram,
+                const crab_cost_function_type *cost_function,
+                uint64_t                      *curve)
 {
-    int    fuel_floor = 0;
-    int    fuel_ceil = 0;
-    int    diff;
-    int    meeting_position_int;
-    size_t i;
+    uint64_t *cost_table = NULL;
+    uint64_t *second_diff = NULL;
+    uint64_t  tail;
+    uint64_t  spike;
+    size_t    num_positions = histogram.num_positions;
+    int64_t   x;
+    size_t    t, t_start, t_end;
+
+    cost_table = make_cost_table(histogram, cost_function);
+
+    curve[0] = find_fuel_at_position(histogram, cost_table, 0);
+    if (num_positions > 1) {
+        curve[1] = find_fuel_at_position(histogram, cost_table, 1);
+    }
+    if (num_positions <= 2) {
+        free(cost_table);
+        return;
+    }
 
     /*
-     * Check both the floor and ceil of the mean and choose the lowest total.
+     * Second difference of g at distance d. At d = 0 the left neighbour is
+     * g(-1) = cost(1).
      */
+    second_diff = malloc_b(num_positions * sizeof(uint64_t));
+    second_diff[0] = 2 * cost_table[1] - 2 * cost_table[0];
+    for (x = 1; x < num_positions; x++) {
+        second_diff[x] = cost_table[x-1] - 2 * cost_table[x]
+                         + cost_table[x+1];
+    }
+    tail = second_diff[num_positions - 1];
 
-    meeting_position_int = floor(meeting_position);
-    for (i = 0; i < len; i++) {
-        diff = abs(numbers_array[i] - meeting_position_int);
-        fuel_floor += (diff * (diff + 1)) / 2;
+    /* curve[t] temporarily holds the second difference of C at t */
+    for (t = 2; t < num_positions; t++) {
+        curve[t] = tail * histogram.num_crabs;
+    }
+    for (x = -((int64_t) num_positions - 1); x < (int64_t) num_positions;
+         x++) {
+        spike = second_diff[llabs(x)] - tail;
+        if (spike == 0) {
+            continue;
+        }
+        /* Only t in [1, num_positions - 2] is needed, with t - x in range */
+        t_start = MAX(1, x);
+        t_end = MIN((int64_t) num_positions - 1, (int64_t) num_positions + x);
+        for (t = t_start; t < t_end; t++) {
+            curve[t+1] += spike * histogram.counts[t - x];
+        }
     }
 
-    meeting_position_int = ceil(meeting_position);
-    for (i = 0; i < len; i++) {
-        diff = abs(numbers_array[i] - meeting_position_int);
-        fuel_ceil += (diff * (diff + 1)) / 2;
+    for (t = 2; t < num_positions; t++) {
+        curve[t] += 2 * curve[t-1] - curve[t-2];
     }
 
-    return (fuel_floor < fuel_ceil ? fuel_floor : fuel_ceil);
+    free(second_diff);
+    second_diff = NULL;
+    free(cost_table);
+    cost_table = NULL;
+}
+
+/*
+ * sweep_fuel_from_sums
+ *
+ * Find the total fuel for every relative meeting position in one sweep, for
+ * a cost with weights. For a position t, with C, S and Q the count,
+ * sum and squared sum of relative positions, and C_l and S_l the same for
+ * only crabs left of t:
+ *   sum |p - t|   = (t * C_l - S_l) + ((S - S_l) - t * (C - C_l))
+ *   sum (p - t)^2 = Q - 2tS + t^2 * C
+ * so each position takes O(1) as C_l and S_l are kept as the sweep goes.
+ * Intermediate values may wrap, but unsigned 64-bit arithmetic is modular so
+ * the totals are exact as long as they (before the shift) fit in 64 bits.
+ *
+ * Argument: histogram
+ *     Histogram of crab positions.
+ * Argument: cost_function
+ *     Cost function for one crab. Must have weights.
+ * Argument: curve
+ *     OUT: Array of num_positions elements to write the total fuel for every
+ *     relative position into, or NULL if only the best alignment is wanted.
+ *
+ * Return: crab_alignment_type
+ *     Best alignment, with position relative to min_position.
+ */
+static crab_alignment_type
+sweep_fuel_from_sums(crab_histogram_type            histogram,
+                     const crab_cost_function_type *cost_function,
+                     uint64_t                      *curve)
+{
+    crab_alignment_type alignment;
+    uint64_t            count_left = 0;
+    uint64_t            sum_left = 0;
+    uint64_t            linear_fuel;
+    uint64_t            squared_fuel;
+    uint64_t            fuel;
+    uint64_t            t;
+
+    assert(cost_function->linear_weight > 0
+           || cost_function->squared_weight > 0);
+
+    alignment.position = 0;
+    alignment.fuel = UINT64_MAX;
+    for (t = 0; t < histogram.num_positions; t++) {
+        linear_fuel = (t * count_left - sum_left)
+                      + ((histogram.position_sum - sum_left)
+                         - t * (histogram.num_crabs - count_left));
+        squared_fuel = histogram.position_squared_sum
+                       - 2 * t * histogram.position_sum
+                       + t * t * histogram.num_crabs;
+        fuel = (cost_function->linear_weight * linear_fuel
+                + cost_function->squared_weight * squared_fuel)
+               >> cost_function->weight_shift;
+
+        if (curve != NULL) {
+            curve[t] = fuel;
+        }
+        if (fuel < alignment.fuel) {
+            alignment.fuel = fuel;
+            alignment.position = t;
+        }
+
+        count_left += histogram.counts[t];
+        sum_left += t * histogram.counts[t];
+    }
+
+    return (alignment);
+}
+
+/*
+ * find_best_alignment
+ *
+ * Find the meeting position with the lowest total fuel.
+ *
+ * Costs with weights (linear, triangular and quadratic) evaluate
+ * every position in O(1) each with sweep_fuel_from_sums(). Otherwise, if the
+ * whole curve is wanted, or the cost is not convex (capped linear), every
+ * position is evaluated with fill_fuel_curve(). Otherwise (cubic) the total
+ * fuel is convex in the position, so the first position where it stops
+ * decreasing is found by binary search, evaluating only
+ * O(log(num_positions)) positions.
+ *
+ * Argument: histogram
+ *     Histogram of crab positions.
+ * Argument: cost_function
+ *     Cost function for one crab.
+ * Argument: curve
+ *     OUT: Array of num_positions elements to write the total fuel for every
+ *     relative position into, or NULL if only the best alignment is wanted.
+ *
+ * Return: crab_alignment_type
+ */
+static crab_alignment_type
+find_best_alignment(crab_histogram_type            histogram,
+                    const crab_cost_function_type *cost_function,
+                    uint64_t                      *curve)
+{
+    crab_alignment_type  alignment;
+    uint64_t            *cost_table = NULL;
+    uint64_t            *curve_to_fill = NULL;
+    size_t               low, high, mid;
+    size_t               t;
+
+    if (cost_function->linear_weight > 0
+        || cost_function->squared_weight > 0) {
+        alignment = sweep_fuel_from_sums(histogram, cost_function, curve);
+    } else if (curve != NULL || !cost_function->is_convex) {
+        curve_to_fill = curve;
+        if (curve_to_fill == NULL) {
+            curve_to_fill = malloc_b(histogram.num_positions *
+                                     sizeof(uint64_t));
+        }
+        fill_fuel_curve(histogram, cost_function, curve_to_fill);
+
+        alignment.position = 0;
+        alignment.fuel = curve_to_fill[0];
+        for (t = 1; t < histogram.num_positions; t++) {
+            if (curve_to_fill[t] < alignment.fuel) {
+                alignment.position = t;
+                alignment.fuel = curve_to_fill[t];
+            }
+        }
+
+        if (curve_to_fill != curve) {
+            free(curve_to_fill);
+        }
+        curve_to_fill = NULL;
+    } else {
+        cost_table = make_cost_table(histogram, cost_function);
+
+        low = 0;
+        high = histogram.num_positions - 1;
+        while (low < high) {
+            mid = low + (high - low) / 2;
+            if (find_fuel_at_position(histogram, cost_table, mid + 1) >=
+                find_fuel_at_position(histogram, cost_table, mid)) {
+                high = mid;
+            } else {
+                low = mid + 1;
+            }
+        }
+        alignment.position = low;
+        alignment.fuel = find_fuel_at_position(histogram, cost_table, low);
+
+        free(cost_table);
+        cost_table = NULL;
+    }
+
+    alignment.position += histogram.min_position;
+
+    return (alignment);
+}
+
+/*
+ * find_crab_cost_function
+ *
+ * Look up a cost function by name.
+ *
+ * Argument: name
+ *     Name of the cost function in crab_cost_functions.
+ *
+ * Return: const crab_cost_function_type *
+ */
+static const crab_cost_function_type *
+find_crab_cost_function(char *name)
+{
+    size_t i;
+
+    for (i = 0; i < NUM_CRAB_COSTS; i++) {
+        if (STRS_EQUAL(name, crab_cost_functions[i].name)) {
+            return (&crab_cost_functions[i]);
+        }
+    }
+    fprintf(stderr, "Unknown cost %s\n", name);
+    assert(false);
+
+    return (NULL);
+}
+
+/*
+ * print_fuel_curve
+ *
+ * Print the total fuel for every meeting position from the smallest to the
+ * largest crab position, then the best one. The best is found again without
+ * the curve, by the cheapest method for the cost, and checked to agree.
+ *
+ * Argument: file_name
+ *     File to read crab positions from.
+ * Argument: cost_name
+ *     Name of the cost function in crab_cost_functions.
+ *
+ * Return: void
+ */
+static void
+print_fuel_curve(char *file_name, char *cost_name)
+{
+    const crab_cost_function_type *cost_function = NULL;
+    char                          *text = NULL;
+    size_t                         text_len;
+    crab_histogram_type            histogram;
+    crab_alignment_type            alignment, best;
+    uint64_t                      *curve = NULL;
+    size_t                         t;
+
+    cost_function = find_crab_cost_function(cost_name);
+    text = read_file_to_buffer(file_name, &text_len);
+    histogram = parse_text_into_crab_histogram(text);
+
+    curve = malloc_b(histogram.num_positions * sizeof(uint64_t));
+    alignment = find_best_alignment(histogram, cost_function, curve);
+    best = find_best_alignment(histogram, cost_function, NULL);
+    assert(best.fuel == alignment.fuel);
+
+    for (t = 0; t < histogram.num_positions; t++) {
+        printf("Position %" PRId64 ": fuel needed = %" PRIu64 "\n",
+               histogram.min_position + (int64_t) t, curve[t]);
+    }
+    printf("Best (%s): Meeting position = %" PRId64 ", "
+           "fuel needed = %" PRIu64 "\n",
+           cost_function->name, alignment.position, alignment.fuel);
+
+    free(curve);
+    curve = NULL;
+    free_crab_histogram(&histogram);
+    free(text);
+    text = NULL;
 }
 
 /*
@@ -98,51 +651,52 @@ find_fuel_needed_part_2(int *numbers_array,
 static void
 runner(char *file_name, bool print_output)
 {
-    parsed_text_type  parsed_text;
-    parsed_text_type  split_text;
-    int              *crab_positions = NULL;
-    int               median;
-    double            mean;
-    int               fuel_needed;
-
-    parsed_text = parse_file(file_name);
-    split_text = split_string_on_char(parsed_text.lines[0].line, ',');
-    crab_positions = parse_text_to_ints(split_text);
-
-    sort_numbers(crab_positions, split_text.num_lines);
-    median = find_median_of_sorted_array(crab_positions, split_text.num_lines);
-    fuel_needed = find_fuel_needed_part_1(crab_positions,
-                                          split_text.num_lines,
-                                          median);
-    if (print_output) {
-        printf("Part 1: Median value = %d, fuel needed = %d\n",
-               median, fuel_needed);
-    }
+    char                *text = NULL;
+    size_t               text_len;
+    crab_histogram_type  histogram;
+    crab_alignment_type  part_1, part_2;
 
-    mean = find_mean_of_array(crab_positions, split_text.num_lines);
-    fuel_needed = find_fuel_needed_part_2(crab_positions,
-                                          split_text.num_lines,
-                                          mean);
+    text = read_file_to_buffer(file_name, &text_len);
+    histogram = parse_text_into_crab_histogram(text);
+
+    part_1 = find_best_alignment(histogram, &crab_cost_functions[LINEAR_COST],
+                                 NULL);
+    part_2 = find_best_alignment(histogram,
+                                 &crab_cost_functions[TRIANGULAR_COST], NULL);
     if (print_output) {
-        printf("Part 2: Mean value = %.2f, fuel needed = %d\n",
-               mean, fuel_needed);
+        printf("Part 1: Meeting position = %" PRId64 ", "
+               "fuel needed = %" PRIu64 "\n",
+               part_1.position, part_1.fuel);
+        printf("Part 2: Meeting position = %" PRId64 ", "
+               "fuel needed = %" PRIu64 "\n",
+               part_2.position, part_2.fuel);
     }
 
-    free(crab_positions);
-    crab_positions = NULL;
-
-    free_parsed_text(split_text);
-    free_parsed_text(parsed_text);
+    free_crab_histogram(&histogram);
+    free(text);
+    text = NULL;
 }
 
 /*
  * Main function.
+ *
+ * Usage:
+ *   day_07 <file>
+ *       Solve both parts.
+ *   day_07 --curve <file> <cost>
+ *       Print the total fuel for every meeting position with a named cost,
+ *       one of linear, triangular, quadratic, cubic or capped_linear.
  */
 int
 main(int argc, char **argv)
 {
     char *file_name = NULL;
 
+    if (argc == 4 && STRS_EQUAL(argv[1], "--curve")) {
+        print_fuel_curve(argv[2], argv[3]);
+        return (0);
+    }
+
     assert(argc == 2);
     file_name = argv[1];
 
@@ -2,6 +2,9 @@
  * AoC 2021 Day 8 solution
  */
 
+#include <immintrin.h>
+#include <unistd.h>
+
 #include "utils.h"
 
 /* Number of digits in the input */
@@ -10,377 +13,989 @@
 /* Number of digits in the output */
 #define NUM_OUTPUTS 4
 
-/* Max array len to hold a digit string (7 segments + null char) */
-#define MAX_PATTERN_STR_LEN 8
+/* Number of segments in a display */
+#define NUM_SEGMENTS 7
+
+/* Slots for the patterns scanned from a line, at least those of a note */
+#define MAX_PATTERNS_PER_LINE 16
+
+/* Longest line scanned by the AVX2 version, a multiple of the vector size */
+#define AVX2_MAX_LINE_LEN 128
+
+/* Number of bytes in an AVX2 vector */
+#define AVX2_BYTES_PER_VECTOR 32
+
+/* Number of notes decoded at once by the AVX2 version, one per byte */
+#define AVX2_NOTES_PER_VECTOR 32
 
-/* Macros for easily identifying unqiue numbers for part 1 */
-#define IS_1(str)        (strlen(str) == 2) // 2 segments
-#define IS_7(str)        (strlen(str) == 3) // 3 segments
-#define IS_4(str)        (strlen(str) == 4) // 4 segments
-#define IS_2_3_OR_5(str) (strlen(str) == 5) // 5 segments
-#define IS_0_6_OR_9(str) (strlen(str) == 6) // 6 segments
-#define IS_8(str)        (strlen(str) == 7) // 7 segments
+/* Fewest bytes of notes worth giving a thread of their own */
+#define MIN_BYTES_PER_THREAD (1 << 18)
 
 /*
- * note_type
+ * Shift the bytes of an AVX2 vector up by a constant 1 to 16 positions,
+ * filling the bottom from the top of the vector before it.
+ */
+#define SHIFT_BYTES_UP_AVX2(current, previous, shift)                         \
+    _mm256_alignr_epi8((current),                                             \
+                       _mm256_permute2x128_si256((previous), (current), 0x21),\
+                       16 - (shift))
+
+/*
+ * Largest signature of a pattern, if every segment was lit in every unique
+ * signal.
+ */
+#define MAX_SIGNATURE (NUM_SEGMENTS * NUM_UNIQUE_SIGNALS)
+
+/* Macro for easily identifying unqiue numbers for part 1 from their masks */
+#define IS_1_4_7_OR_8(mask)                                                   \
+    (__builtin_popcount(mask) == 2     /* 1 */                                \
+     || __builtin_popcount(mask) == 3  /* 7 */                                \
+     || __builtin_popcount(mask) == 4  /* 4 */                                \
+     || __builtin_popcount(mask) == 7) /* 8 */
+
+/*
+ * notes_type
+ *
+ * Every note, with each of its patterns as a mask of its lit segments: bit 0
+ * for segment 'a' up to bit 6 for segment 'g'. Stored as one array per
+ * pattern position, so the same pattern of consecutive notes is contiguous.
  *
  * Element: unique_signals
- *     The NUM_UNIQUE_SIGNALS before the '|' delimeter in a note.
+ *     Arrays of the NUM_UNIQUE_SIGNALS patterns before the '|' delimeter in
+ *     each note. unique_signals[j][i] is pattern j of note i.
  * Element: output
- *     The NUM_OUTPUTS after the '|' delimeter in a note.
+ *     Arrays of the NUM_OUTPUTS patterns after the '|' delimeter in each note.
+ * Element: num_notes
+ *     Number of notes each array has space for.
  */
-typedef struct Note {
-    char unique_signals[NUM_UNIQUE_SIGNALS][MAX_PATTERN_STR_LEN];
-    int  unique_signals_nums[NUM_UNIQUE_SIGNALS];
-    char output[NUM_OUTPUTS][MAX_PATTERN_STR_LEN];
-    int  output_nums[NUM_OUTPUTS];
-} note_type;
+typedef struct Notes {
+    uint8_t *unique_signals[NUM_UNIQUE_SIGNALS];
+    uint8_t *output[NUM_OUTPUTS];
+    size_t   num_notes;
+} notes_type;
 
 /*
- * parse_text_into_note_types
+ * note_chunk_type
  *
- * Parse lines of notes into an array of note_type structs.
+ * Work for one thread scanning and decoding the notes in a range of the text.
  *
- * Argument: parsed_text
- *     Parsed text struct from the day's input.
+ * Element: text
+ *     Text of all the notes.
+ * Element: start
+ *     Offset of the first line in the chunk.
+ * Element: end
+ *     One past the offset of the last line in the chunk.
+ * Element: notes
+ *     Notes of the whole text, shared by all chunks.
+ * Element: first_note
+ *     Index in notes of the chunk's first note.
+ * Element: num_lines
+ *     OUT: Number of lines in the chunk, which is at least its number of
+ *     notes.
+ * Element: table
+ *     Table from a pattern's signature to its digit. Only read.
+ * Element: num_1_4_7_8s
+ *     OUT: Number of 1s, 4s, 7s and 8s in the outputs of the chunk's notes.
+ * Element: output_sum
+ *     OUT: Sum of the outputs of the chunk's notes.
+ */
+typedef struct Note_Chunk {
+    char         *text;
+    size_t        start;
+    size_t        end;
+    notes_type    notes;
+    size_t        first_note;
+    size_t        num_lines;
+    const int8_t *table;
+    size_t        num_1_4_7_8s;
+    size_t        output_sum;
+} note_chunk_type;
+
+/*
+ * The segments of each digit on a correctly wired display, indexed by digit.
+ */
+static const char *DIGIT_PATTERNS[NUM_UNIQUE_SIGNALS] = {
+    "abcefg", "cf", "acdeg", "acdfg", "bcdf",
+    "abdfg", "abdefg", "acf", "abcdefg", "abcdfg",
+};
+
+/*
+ * pattern_to_mask
+ *
+ * Convert a string of segment letters into a mask of lit segments.
+ *
+ * Argument: pattern
+ *     String of segment letters from 'a' to 'g', in any order.
  *
- * Return: note_type
+ * Return: uint8_t
  */
-static note_type *
-parse_text_into_note_types(parsed_text_type parsed_text)
+static uint8_t
+pattern_to_mask(const char *pattern)
 {
-    size_t     i, j;
-    char       format_str[] = "%s %s %s %s %s %s %s %s %s %s | %s %s %s %s";
-    note_type *notes = NULL;
+    uint8_t mask = 0;
 
-    /*
-     * Check the format string len matches the expected number of unique
-     * signals and outputs
-     */
-    assert(strlen(format_str) == ((NUM_UNIQUE_SIGNALS + NUM_OUTPUTS) * 3 + 1));
-
-    notes = calloc_b(parsed_text.num_lines, sizeof(note_type));
-
-    for (i = 0; i < parsed_text.num_lines; i++) {
-        sscanf(parsed_text.lines[i].line,
-               format_str,
-               notes[i].unique_signals[0],
-               notes[i].unique_signals[1],
-               notes[i].unique_signals[2],
-               notes[i].unique_signals[3],
-               notes[i].unique_signals[4],
-               notes[i].unique_signals[5],
-               notes[i].unique_signals[6],
-               notes[i].unique_signals[7],
-               notes[i].unique_signals[8],
-               notes[i].unique_signals[9],
-               notes[i].output[0],
-               notes[i].output[1],
-               notes[i].output[2],
-               notes[i].output[3]);
-
-        /* Sort strings so they are easier to deal with */
-        for (j = 0; j < NUM_UNIQUE_SIGNALS; j++) {
-            sort_string(notes[i].unique_signals[j],
-                        strlen(notes[i].unique_signals[j]));
-        }
-        for (j = 0; j < NUM_OUTPUTS; j++) {
-            sort_string(notes[i].output[j],
-                        strlen(notes[i].output[j]));
-        }
+    for (; *pattern != '\0'; pattern++) {
+        assert(*pattern >= 'a' && *pattern < 'a' + NUM_SEGMENTS);
+        mask |= 1 << (*pattern - 'a');
+    }
 
-        /*
-         * Set the corresponding numbers to 100 (i.e. an impossible value on
-         * the display) so we know they have not yet been identified.
-         */
-        for (j = 0; j < NUM_UNIQUE_SIGNALS; j++) {
-            notes[i].unique_signals_nums[j] = 100;
-        }
-        for (j = 0; j < NUM_OUTPUTS; j++) {
-            notes[i].output_nums[j] = 100;
-        }
+    return (mask);
+}
+
+/*
+ * find_pattern_signature
+ *
+ * Find the signature of a pattern: the sum over its lit segments of how many
+ * of the unique signals light that segment. Rewiring the segments does not
+ * change the signature, and every digit has a different one, so it identifies
+ * the digit.
+ *
+ * Argument: unique_signals
+ *     Masks of the NUM_UNIQUE_SIGNALS unique signals.
+ * Argument: mask
+ *     Mask of the pattern.
+ *
+ * Return: int
+ */
+static inline int
+find_pattern_signature(const uint8_t *unique_signals, uint8_t mask)
+{
+    size_t i;
+    int    signature = 0;
+
+    for (i = 0; i < NUM_UNIQUE_SIGNALS; i++) {
+        signature += __builtin_popcount(unique_signals[i] & mask);
+    }
+
+    return (signature);
+}
+
+/*
+ * make_digit_signature_table
+ *
+ * Make the table from a pattern's signature to its digit, from the correctly
+ * wired digits.
+ *
+ * Argument: table
+ *     OUT: Digit of each signature, or -1 if no digit has that signature.
+ *
+ * Return: void
+ */
+static void
+make_digit_signature_table(int8_t table[MAX_SIGNATURE + 1])
+{
+    uint8_t digit_masks[NUM_UNIQUE_SIGNALS];
+    int     signature;
+    size_t  i;
+
+    for (i = 0; i < NUM_UNIQUE_SIGNALS; i++) {
+        digit_masks[i] = pattern_to_mask(DIGIT_PATTERNS[i]);
+    }
+
+    memset(table, -1, (MAX_SIGNATURE + 1) * sizeof(int8_t));
+    for (i = 0; i < NUM_UNIQUE_SIGNALS; i++) {
+        signature = find_pattern_signature(digit_masks, digit_masks[i]);
+        /* Every digit must have a different signature */
+        assert(table[signature] == -1);
+        table[signature] = i;
+    }
+}
+
+/*
+ * make_notes
+ *
+ * Make a notes struct with space for a number of notes.
+ *
+ * Argument: num_notes
+ *     Number of notes to make space for.
+ *
+ * Return: notes_type
+ */
+static notes_type
+make_notes(size_t num_notes)
+{
+    notes_type notes;
+    uint8_t   *patterns = NULL;
+    size_t     j;
+
+    /* Every pattern array is in one block, freed through the first array */
+    patterns = calloc_b(MAX(1, num_notes),
+                        NUM_UNIQUE_SIGNALS + NUM_OUTPUTS);
+    for (j = 0; j < NUM_UNIQUE_SIGNALS; j++) {
+        notes.unique_signals[j] = &patterns[j * num_notes];
+    }
+    for (j = 0; j < NUM_OUTPUTS; j++) {
+        notes.output[j] = &patterns[(NUM_UNIQUE_SIGNALS + j) * num_notes];
     }
+    notes.num_notes = num_notes;
 
     return (notes);
 }
 
 /*
- * find_num_1_4_7_8_in_output
+ * free_notes
  *
- * Find the number of easily identifiable 1s, 4s, 7s and 8s in the outputs
- * of the notes.
+ * Free allocated memory from the notes struct.
  *
  * Argument: notes
- *     Array of note structs. The outputs do not need to yet be identified.
+ *     notes_type struct to free.
+ *
+ * Return: void
+ */
+static void
+free_notes(notes_type *notes)
+{
+    size_t j;
+
+    free(notes->unique_signals[0]);
+    for (j = 0; j < NUM_UNIQUE_SIGNALS; j++) {
+        notes->unique_signals[j] = NULL;
+    }
+    for (j = 0; j < NUM_OUTPUTS; j++) {
+        notes->output[j] = NULL;
+    }
+}
+
+/*
+ * count_lines
+ *
+ * Count the lines in some text, including a last line with no newline.
+ *
+ * Argument: text
+ *     Text to count. Does not need to be null terminated.
  * Argument: len
- *     Number of elements in the array.
+ *     Number of bytes in text.
  *
  * Return: size_t
  */
 static size_t
-find_num_1_4_7_8_in_output(note_type *notes, size_t len)
+count_lines(char *text, size_t len)
 {
-    size_t i, j;
-    size_t num_1_4_7_8s = 0;
+    size_t num_lines = 0;
+    char  *newline;
+    char  *end = text + len;
+
+    while ((newline = memchr(text, '\n', end - text)) != NULL) {
+        num_lines++;
+        text = newline + 1;
+    }
+
+    return (num_lines + (text < end));
+}
+
+/*
+ * scan_note_line
+ *
+ * Scan the patterns of one line into masks without branching on the bytes.
+ * Each byte is either a segment letter to add to the current pattern, or
+ * anything else (a space, the '|' delimeter or a carriage return) which ends
+ * the current pattern if it has any segments. The current pattern is written
+ * to its slot after every byte, and the slot only moves on when a pattern
+ * ends.
+ *
+ * Argument: line
+ *     Text of the line, without its newline.
+ * Argument: len
+ *     Number of bytes in line.
+ * Argument: patterns
+ *     OUT: Mask of each pattern, in order. Only the first
+ *     MAX_PATTERNS_PER_LINE are kept.
+ *
+ * Return: size_t
+ *     Number of patterns on the line.
+ */
+static size_t
+scan_note_line(const char *line,
+               size_t      len,
+               uint8_t     patterns[MAX_PATTERNS_PER_LINE])
+{
+    /* The extra slot takes the writes after the last kept pattern */
+    uint8_t  slots[MAX_PATTERNS_PER_LINE + 1];
+    size_t   num_patterns = 0;
+    uint32_t mask = 0;
+    uint32_t segment;
+    uint32_t is_segment;
+    size_t   i;
 
     for (i = 0; i < len; i++) {
+        segment = (uint8_t) line[i] - 'a';
+        is_segment = (segment < NUM_SEGMENTS);
+        slots[MIN(num_patterns, MAX_PATTERNS_PER_LINE)] = mask;
+        num_patterns += !is_segment & (mask != 0);
+        mask = (mask | (1u << (segment & 7))) & -is_segment;
+    }
+    slots[MIN(num_patterns, MAX_PATTERNS_PER_LINE)] = mask;
+    num_patterns += (mask != 0);
+
+    memcpy(patterns, slots, MAX_PATTERNS_PER_LINE);
+
+    return (num_patterns);
+}
+
+/*
+ * scan_note_line_avx2
+ *
+ * AVX2 version of scan_note_line(). Every byte of the line is turned into its
+ * segment's bit at once (0 for anything but a segment letter). Each byte is
+ * then ORed with the bytes before it in its run of letters, doubling the
+ * distance each step, so after three steps the last letter of every run holds
+ * the mask of its whole pattern.
+ *
+ * Argument: line
+ *     Text of the line, without its newline. At most AVX2_MAX_LINE_LEN bytes.
+ * Argument: len
+ *     Number of bytes in line.
+ * Argument: readable
+ *     Number of bytes which can be read from line, including and past its
+ *     newline. Lines with at least AVX2_MAX_LINE_LEN readable bytes are read
+ *     in place, otherwise they are copied first.
+ * Argument: patterns
+ *     OUT: Mask of each pattern, in order. Only the first
+ *     MAX_PATTERNS_PER_LINE are kept.
+ *
+ * Return: size_t
+ *     Number of patterns on the line.
+ */
+__attribute__((target("avx2,bmi,popcnt")))
+static size_t
+scan_note_line_avx2(const char *line,
+                    size_t      len,
+                    size_t      readable,
+                    uint8_t     patterns[MAX_PATTERNS_PER_LINE])
+{
+    uint8_t            text[AVX2_MAX_LINE_LEN];
+    uint8_t            bits[AVX2_MAX_LINE_LEN];
+    __m256i            segment_bits = _mm256_setr_epi8(0, 1, 2, 4, 8, 16, 32,
+                                                       64, 0, 0, 0, 0, 0, 0,
+                                                       0, 0, 0, 1, 2, 4, 8,
+                                                       16, 32, 64, 0, 0, 0,
+                                                       0, 0, 0, 0, 0);
+    __m256i            v[AVX2_MAX_LINE_LEN / AVX2_BYTES_PER_VECTOR];
+    __m256i            in_run[AVX2_MAX_LINE_LEN / AVX2_BYTES_PER_VECTOR];
+    __m256i            zero = _mm256_setzero_si256();
+    __m256i            previous, previous_in_run;
+    unsigned __int128  letters = 0;
+    uint64_t           low, high;
+    size_t             num_patterns;
+    size_t             i, j;
+
+    assert(len <= AVX2_MAX_LINE_LEN);
+    if (readable < AVX2_MAX_LINE_LEN) {
+        memcpy(text, line, len);
+        memset(&text[len], 0, AVX2_MAX_LINE_LEN - len);
+        line = (char *) text;
+    }
+
+    for (i = 0; i < AVX2_MAX_LINE_LEN / AVX2_BYTES_PER_VECTOR; i++) {
+        v[i] = _mm256_loadu_si256(
+                         (__m256i *) &line[i * AVX2_BYTES_PER_VECTOR]);
+        in_run[i] = _mm256_and_si256(
+                _mm256_cmpgt_epi8(v[i], _mm256_set1_epi8('a' - 1)),
+                _mm256_cmpgt_epi8(_mm256_set1_epi8('a' + NUM_SEGMENTS), v[i]));
+        v[i] = _mm256_and_si256(in_run[i],
+                                _mm256_shuffle_epi8(
+                                   segment_bits,
+                                   _mm256_and_si256(v[i],
+                                                    _mm256_set1_epi8(0x0f))));
+        letters |= (unsigned __int128) (uint32_t) _mm256_movemask_epi8(
+                                                                  in_run[i])
+                   << (i * AVX2_BYTES_PER_VECTOR);
+    }
+    /* Drop anything read past the end of the line */
+    if (len < AVX2_MAX_LINE_LEN) {
+        letters &= ((unsigned __int128) 1 << len) - 1;
+    }
+
+    /*
+     * Separators are zero, so ORing in the byte before a letter only adds its
+     * run's segments. in_run then marks bytes whose previous 2 (then 4) bytes
+     * are all letters, so the next step can reach past them.
+     */
+    for (i = AVX2_MAX_LINE_LEN / AVX2_BYTES_PER_VECTOR; i-- > 0;) {
+        previous = (i > 0) ? v[i - 1] : zero;
+        previous_in_run = (i > 0) ? in_run[i - 1] : zero;
+        v[i] = _mm256_or_si256(v[i],
+                               _mm256_and_si256(
+                                   in_run[i],
+                                   SHIFT_BYTES_UP_AVX2(v[i], previous, 1)));
+        in_run[i] = _mm256_and_si256(
+                          in_run[i],
+                          SHIFT_BYTES_UP_AVX2(in_run[i], previous_in_run, 1));
+    }
+    for (i = AVX2_MAX_LINE_LEN / AVX2_BYTES_PER_VECTOR; i-- > 0;) {
+        previous = (i > 0) ? v[i - 1] : zero;
+        previous_in_run = (i > 0) ? in_run[i - 1] : zero;
+        v[i] = _mm256_or_si256(v[i],
+                               _mm256_and_si256(
+                                   in_run[i],
+                                   SHIFT_BYTES_UP_AVX2(v[i], previous, 2)));
+        in_run[i] = _mm256_and_si256(
+                          in_run[i],
+                          SHIFT_BYTES_UP_AVX2(in_run[i], previous_in_run, 2));
+    }
+    for (i = AVX2_MAX_LINE_LEN / AVX2_BYTES_PER_VECTOR; i-- > 0;) {
+        previous = (i > 0) ? v[i - 1] : zero;
+        v[i] = _mm256_or_si256(v[i],
+                               _mm256_and_si256(
+                                   in_run[i],
+                                   SHIFT_BYTES_UP_AVX2(v[i], previous, 4)));
+        _mm256_storeu_si256((__m256i *) &bits[i * AVX2_BYTES_PER_VECTOR],
+                            v[i]);
+    }
+
+    /* The last letter of each run holds its pattern's mask */
+    letters &= ~(letters >> 1);
+    num_patterns = __builtin_popcountll((uint64_t) letters)
+                   + __builtin_popcountll((uint64_t) (letters >> 64));
+    for (j = 0; j < MIN(num_patterns, MAX_PATTERNS_PER_LINE); j++) {
+        low = (uint64_t) letters;
+        high = (uint64_t) (letters >> 64);
+        patterns[j] = bits[(low != 0) ? _tzcnt_u64(low)
+                                      : 64 + _tzcnt_u64(high)];
+        letters &= letters - 1;
+    }
+
+    return (num_patterns);
+}
+
+/*
+ * scan_notes
+ *
+ * Scan notes straight from the text into their pattern masks, a line at a
+ * time. Blank lines are skipped.
+ *
+ * Argument: text
+ *     Text of one note per line. Does not need to be null terminated.
+ * Argument: len
+ *     Number of bytes in text.
+ * Argument: notes
+ *     Notes to scan into.
+ * Argument: first_note
+ *     Index in notes to store the first note at.
+ *
+ * Return: size_t
+ *     Number of notes scanned.
+ */
+static size_t
+scan_notes(char *text, size_t len, notes_type notes, size_t first_note)
+{
+    uint8_t  patterns[MAX_PATTERNS_PER_LINE];
+    size_t   note = first_note;
+    size_t   num_patterns;
+    char    *line = text;
+    char    *end = text + len;
+    char    *newline;
+    bool     use_avx2;
+    size_t   j;
+
+    use_avx2 = __builtin_cpu_supports("avx2")
+               && __builtin_cpu_supports("bmi")
+               && __builtin_cpu_supports("popcnt");
+    while (line < end) {
+        newline = memchr(line, '\n', end - line);
+        if (newline == NULL) {
+            newline = end;
+        }
+        if (use_avx2 && newline - line <= AVX2_MAX_LINE_LEN) {
+            num_patterns = scan_note_line_avx2(line, newline - line,
+                                               end - line, patterns);
+        } else {
+            num_patterns = scan_note_line(line, newline - line, patterns);
+        }
+        line = newline + 1;
+        if (num_patterns == 0) {
+            continue;
+        }
+
+        assert(num_patterns == NUM_UNIQUE_SIGNALS + NUM_OUTPUTS);
+        assert(note < notes.num_notes);
+        for (j = 0; j < NUM_UNIQUE_SIGNALS; j++) {
+            notes.unique_signals[j][note] = patterns[j];
+        }
         for (j = 0; j < NUM_OUTPUTS; j++) {
-            if (IS_1(notes[i].output[j])
-                || IS_4(notes[i].output[j])
-                || IS_7(notes[i].output[j])
-                || IS_8(notes[i].output[j])) {
-                num_1_4_7_8s++;
-            }
+            notes.output[j][note] = patterns[NUM_UNIQUE_SIGNALS + j];
         }
+        note++;
     }
 
-    return (num_1_4_7_8s);
+    return (note - first_note);
 }
 
 /*
- * identify_1_4_7_8s
+ * decode_notes_scalar
  *
- * Identify the easily identifiable 1s, 4s, 7s and 8s in the unique signals
- * of the notes.
+ * Count the 1s, 4s, 7s and 8s in the outputs of a range of notes, and sum
+ * their outputs, one note at a time.
  *
  * Argument: notes
- *     Array of note structs. Nothing needs to have been identified yet.
- * Argument: len
- *     Number of elements in the array.
+ *     Notes to decode.
+ * Argument: start
+ *     Index of the first note to decode.
+ * Argument: end
+ *     One past the index of the last note to decode.
+ * Argument: table
+ *     Table from a pattern's signature to its digit.
+ * Argument: num_1_4_7_8s
+ *     OUT: Number of 1s, 4s, 7s and 8s in the outputs.
+ * Argument: output_sum
+ *     OUT: Sum of the outputs.
  *
  * Return: void
  */
 static void
-identify_1_4_7_8s(note_type *notes, size_t len)
+decode_notes_scalar(notes_type    notes,
+                    size_t        start,
+                    size_t        end,
+                    const int8_t  table[MAX_SIGNATURE + 1],
+                    size_t       *num_1_4_7_8s,
+                    size_t       *output_sum)
 {
-    size_t i, j;
+    uint8_t unique_signals[NUM_UNIQUE_SIGNALS];
+    uint8_t mask;
+    size_t  i, j;
+    int     digit;
+    size_t  output;
 
-    for (i = 0; i < len; i++) {
+    *num_1_4_7_8s = 0;
+    *output_sum = 0;
+    for (i = start; i < end; i++) {
         for (j = 0; j < NUM_UNIQUE_SIGNALS; j++) {
-            if (IS_1(notes[i].unique_signals[j])) {
-                notes[i].unique_signals_nums[j] = 1;
-            } else if (IS_4(notes[i].unique_signals[j])) {
-                notes[i].unique_signals_nums[j] = 4;
-            } else if (IS_7(notes[i].unique_signals[j])) {
-                notes[i].unique_signals_nums[j] = 7;
-            } else if (IS_8(notes[i].unique_signals[j])) {
-                notes[i].unique_signals_nums[j] = 8;
+            unique_signals[j] = notes.unique_signals[j][i];
+        }
+        output = 0;
+        for (j = 0; j < NUM_OUTPUTS; j++) {
+            mask = notes.output[j][i];
+            if (IS_1_4_7_OR_8(mask)) {
+                (*num_1_4_7_8s)++;
             }
+            digit = table[find_pattern_signature(unique_signals, mask)];
+            /* The output should be one of the unique signals */
+            assert(digit != -1);
+            output = output * 10 + digit;
         }
+        *output_sum += output;
     }
 }
 
 /*
- * identify_0_2_3_5_6_9s
+ * popcount_bytes_avx2
+ *
+ * Count the set bits in each byte of a vector.
+ *
+ * Argument: v
+ *     Vector of bytes.
+ *
+ * Return: __m256i
+ *     Vector of the count of each byte.
+ */
+__attribute__((target("avx2")))
+static inline __m256i
+popcount_bytes_avx2(__m256i v)
+{
+    __m256i nibble_counts = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+                                             1, 2, 2, 3, 2, 3, 3, 4,
+                                             0, 1, 1, 2, 1, 2, 2, 3,
+                                             1, 2, 2, 3, 2, 3, 3, 4);
+    __m256i low_mask = _mm256_set1_epi8(0x0f);
+
+    return (_mm256_add_epi8(
+            _mm256_shuffle_epi8(nibble_counts, _mm256_and_si256(v, low_mask)),
+            _mm256_shuffle_epi8(nibble_counts,
+                                _mm256_and_si256(_mm256_srli_epi16(v, 4),
+                                                 low_mask))));
+}
+
+/*
+ * decode_notes_avx2
  *
- * Identify the more difficult 0s, 2s, 3s, 5s, 6s and 9s in the unique signals
- * of the notes.
+ * AVX2 version of decode_notes_scalar(), decoding AVX2_NOTES_PER_VECTOR notes
+ * at a time with one note per byte. Each output digit's signature is compared
+ * against every digit's signature at once, and the digits in each output
+ * position are summed across the notes before being weighted by their place
+ * value.
  *
  * Argument: notes
- *     Array of note structs. The 1s, 4s, 7s and 8s in the unique signals must
- *     have already been identified.
- * Argument: len
- *     Number of elements in the array.
+ *     Notes to decode.
+ * Argument: start
+ *     Index of the first note to decode.
+ * Argument: end
+ *     One past the index of the last note to decode.
+ * Argument: table
+ *     Table from a pattern's signature to its digit.
+ * Argument: num_1_4_7_8s
+ *     OUT: Number of 1s, 4s, 7s and 8s in the outputs.
+ * Argument: output_sum
+ *     OUT: Sum of the outputs.
  *
  * Return: void
  */
+__attribute__((target("avx2,popcnt")))
 static void
-identify_0_2_3_5_6_9s(note_type *notes, size_t len)
+decode_notes_avx2(notes_type    notes,
+                  size_t        start,
+                  size_t        end,
+                  const int8_t  table[MAX_SIGNATURE + 1],
+                  size_t       *num_1_4_7_8s,
+                  size_t       *output_sum)
 {
-    size_t i, j, k;
-    size_t index;
-    size_t matching_segments;
-    char   s[2] = "";
+    __m256i  digit_signatures[NUM_UNIQUE_SIGNALS];
+    __m256i  digit_values[NUM_UNIQUE_SIGNALS];
+    __m256i  unique_signals[NUM_UNIQUE_SIGNALS];
+    __m256i  digit_sums[NUM_OUTPUTS];
+    __m256i  mask, signature, digits, matched, counts, easy, is_digit;
+    uint64_t lanes[4];
+    size_t   tail_1_4_7_8s, tail_sum;
+    size_t   i, j;
+    int      s;
 
-    for (i = 0; i < len; i++) {
+    for (s = 0; s <= MAX_SIGNATURE; s++) {
+        if (table[s] != -1) {
+            digit_signatures[table[s]] = _mm256_set1_epi8(s);
+            digit_values[table[s]] = _mm256_set1_epi8(table[s]);
+        }
+    }
+    for (j = 0; j < NUM_OUTPUTS; j++) {
+        digit_sums[j] = _mm256_setzero_si256();
+    }
+
+    *num_1_4_7_8s = 0;
+    for (i = start; i + AVX2_NOTES_PER_VECTOR <= end;
+         i += AVX2_NOTES_PER_VECTOR) {
         for (j = 0; j < NUM_UNIQUE_SIGNALS; j++) {
-            if (IS_0_6_OR_9(notes[i].unique_signals[j])) {
-                /*
-                 * 0 and 9 share the same segments with 1 and 6 does not. We
-                 * can also easily identify 1. Hence if the string under test
-                 * does not contain the same segments as the 1 it must be a 6,
-                 * otherwise it is a 0 or 9.
-                 * A 4 also contains the same segments as a 9 but not a 0, and
-                 * a 4 is easily identifiable so we can identify the 0 and 9 as
-                 * well.
-                 *
-                 * First find the 1 string then check if each segment is in the
-                 * string under test.
-                 */
-                index = 0;
-                while (!IS_1(notes[i].unique_signals[index])) {
-                    index++;
-                }
-                /*
-                 * Found the 1. Check if each char in it is also in the string
-                 * under test.
-                 */
-                for (k = 0; k < strlen(notes[i].unique_signals[index]); k++) {
-                    s[0] = notes[i].unique_signals[index][k];
-                    if (!is_str_in_str(notes[i].unique_signals[j], s)) {
-                        /* Char was not in string under test, must be a 6. */
-                        notes[i].unique_signals_nums[j] = 6;
-                        break;
-                    }
-                }
-                if (notes[i].unique_signals_nums[j] == 6) {
-                    /* Was a set to a 6, continue. */
-                    continue;
-                }
-                /*
-                 * Was not set to a 6, must be a 0 or 9. Find the 4 then
-                 * check if each segment is in the string under test.
-                 */
-                index = 0;
-                while (!IS_4(notes[i].unique_signals[index])) {
-                    index++;
-                }
-                /* Found the 4 */
-                for (k = 0; k < strlen(notes[i].unique_signals[index]); k++) {
-                    s[0] = notes[i].unique_signals[index][k];
-                    if (!is_str_in_str(notes[i].unique_signals[j], s)) {
-                        /* Char was not in string under test, must be a 0. */
-                        notes[i].unique_signals_nums[j] = 0;
-                        break;
-                    }
-                }
-                if (notes[i].unique_signals_nums[j] != 0) {
-                    /* Was not set to a 0, must be a 9. */
-                    notes[i].unique_signals_nums[j] = 9;
-                }
-            } else if (IS_2_3_OR_5(notes[i].unique_signals[j])) {
-                /*
-                 * 3 shares the same segments with 1, and 2 and 6 do not. We
-                 * can also easily identify 3. Hence if the string under test
-                 * contains the same segments as the 1 it must be a 6,
-                 * otherwise it is a 2 or 6.
-                 *
-                 * A 5 shares 3 segements with a 4, but a 2 only shares 2
-                 * segments with a 4. We can identify a 4 and check how many
-                 * segments match to identify a 2 and a 5.
-                 *
-                 * First find the 1 string then check if each segment is in the
-                 * string under test.
-                 */
-                index = 0;
-                while (!IS_1(notes[i].unique_signals[index])) {
-                    index++;
-                }
-                /*
-                 * Found the 1. Check if each char in it is also in the string
-                 * under test.
-                 */
-                for (k = 0; k < strlen(notes[i].unique_signals[index]); k++) {
-                    s[0] = notes[i].unique_signals[index][k];
-                    if (!is_str_in_str(notes[i].unique_signals[j], s)) {
-                        // Char was not in string under test, must be a 2 or 5.
-                        break;
-                    }
-                }
-                if (k == strlen(notes[i].unique_signals[index])) {
-                    /*
-                     * Checked all characters successfully without breaking,
-                     * must be a 3.
-                     */
-                    notes[i].unique_signals_nums[j] = 3;
-                    continue;
-                }
-                /*
-                 * Find the 4 and check how many matches there are with the
-                 * string under test.
-                 */
-                index = 0;
-                while (!IS_4(notes[i].unique_signals[index])) {
-                    index++;
-                }
-                /* Found the 4 */
-                matching_segments = 0;
-                for (k = 0; k < strlen(notes[i].unique_signals[index]); k++) {
-                    s[0] = notes[i].unique_signals[index][k];
-                    if (is_str_in_str(notes[i].unique_signals[j], s)) {
-                        matching_segments++;
-                    }
-                }
-                if (matching_segments == 3) {
-                    /* 3 matches, must be a 5 */
-                    notes[i].unique_signals_nums[j] = 5;
-                } else if (matching_segments == 2) {
-                    /* 2 matches, must be a 2 */
-                    notes[i].unique_signals_nums[j] = 2;
-                } else {
-                    /* Something has gone wrong */
-                    assert(false);
-                }
+            unique_signals[j] = _mm256_loadu_si256(
+                                     (__m256i *) &notes.unique_signals[j][i]);
+        }
+        for (j = 0; j < NUM_OUTPUTS; j++) {
+            mask = _mm256_loadu_si256((__m256i *) &notes.output[j][i]);
+
+            counts = popcount_bytes_avx2(mask);
+            easy = _mm256_or_si256(
+                    _mm256_or_si256(
+                            _mm256_cmpeq_epi8(counts, _mm256_set1_epi8(2)),
+                            _mm256_cmpeq_epi8(counts, _mm256_set1_epi8(3))),
+                    _mm256_or_si256(
+                            _mm256_cmpeq_epi8(counts, _mm256_set1_epi8(4)),
+                            _mm256_cmpeq_epi8(counts, _mm256_set1_epi8(7))));
+            *num_1_4_7_8s += __builtin_popcount(_mm256_movemask_epi8(easy));
+
+            signature = _mm256_setzero_si256();
+            for (s = 0; s < NUM_UNIQUE_SIGNALS; s++) {
+                signature = _mm256_add_epi8(
+                        signature,
+                        popcount_bytes_avx2(
+                                _mm256_and_si256(unique_signals[s], mask)));
             }
+
+            digits = _mm256_setzero_si256();
+            matched = _mm256_setzero_si256();
+            for (s = 0; s < NUM_UNIQUE_SIGNALS; s++) {
+                is_digit = _mm256_cmpeq_epi8(signature, digit_signatures[s]);
+                digits = _mm256_or_si256(digits,
+                                         _mm256_and_si256(is_digit,
+                                                          digit_values[s]));
+                matched = _mm256_or_si256(matched, is_digit);
+            }
+            /* The output should be one of the unique signals */
+            assert(_mm256_movemask_epi8(matched) == -1);
+
+            digit_sums[j] = _mm256_add_epi64(
+                    digit_sums[j],
+                    _mm256_sad_epu8(digits, _mm256_setzero_si256()));
         }
     }
+
+    *output_sum = 0;
+    for (j = 0; j < NUM_OUTPUTS; j++) {
+        _mm256_storeu_si256((__m256i *) lanes, digit_sums[j]);
+        *output_sum = *output_sum * 10
+                      + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+
+    decode_notes_scalar(notes, i, end, table, &tail_1_4_7_8s, &tail_sum);
+    *num_1_4_7_8s += tail_1_4_7_8s;
+    *output_sum += tail_sum;
 }
 
 /*
- * identify_outputs
+ * decode_notes
  *
- * Identify the output digits.
+ * Count the 1s, 4s, 7s and 8s in the outputs of a range of notes, and sum
+ * their outputs. Uses AVX2 if the CPU supports it.
  *
  * Argument: notes
- *     Array of note structs. All unique signals for each note must have
- *     already been identified.
+ *     Notes to decode.
+ * Argument: start
+ *     Index of the first note to decode.
+ * Argument: end
+ *     One past the index of the last note to decode.
+ * Argument: table
+ *     Table from a pattern's signature to its digit.
+ * Argument: num_1_4_7_8s
+ *     OUT: Number of 1s, 4s, 7s and 8s in the outputs.
+ * Argument: output_sum
+ *     OUT: Sum of the outputs.
+ *
+ * Return: void
+ */
+static void
+decode_notes(notes_type    notes,
+             size_t        start,
+             size_t        end,
+             const int8_t  table[MAX_SIGNATURE + 1],
+             size_t       *num_1_4_7_8s,
+             size_t       *output_sum)
+{
+    if (__builtin_cpu_supports("avx2")) {
+        decode_notes_avx2(notes, start, end, table, num_1_4_7_8s,
+                          output_sum);
+        return;
+    }
+
+    decode_notes_scalar(notes, start, end, table, num_1_4_7_8s, output_sum);
+}
+
+/*
+ * count_note_chunk
+ *
+ * Thread function to count the lines of a chunk.
+ *
+ * Argument: arg
+ *     note_chunk_type of the chunk.
+ *
+ * Return: void *
+ */
+static void *
+count_note_chunk(void *arg)
+{
+    note_chunk_type *chunk = arg;
+
+    chunk->num_lines = count_lines(&(chunk->text[chunk->start]),
+                                   chunk->end - chunk->start);
+
+    return (NULL);
+}
+
+/*
+ * decode_note_chunk
+ *
+ * Thread function to scan the notes of a chunk then decode them.
+ *
+ * Argument: arg
+ *     note_chunk_type of the chunk. Its first_note must be set.
+ *
+ * Return: void *
+ */
+static void *
+decode_note_chunk(void *arg)
+{
+    note_chunk_type *chunk = arg;
+    size_t           num_notes;
+
+    num_notes = scan_notes(&(chunk->text[chunk->start]),
+                           chunk->end - chunk->start,
+                           chunk->notes,
+                           chunk->first_note);
+    decode_notes(chunk->notes, chunk->first_note,
+                 chunk->first_note + num_notes, chunk->table,
+                 &(chunk->num_1_4_7_8s), &(chunk->output_sum));
+
+    return (NULL);
+}
+
+/*
+ * decode_notes_parallel
+ *
+ * Scan and decode every note in some text. The text is split at line
+ * boundaries into one chunk per thread. The lines of each chunk are counted
+ * in parallel to place its notes in the shared arrays, then each chunk is
+ * scanned and decoded in parallel.
+ *
+ * Argument: text
+ *     Text of one note per line. Does not need to be null terminated, so can
+ *     be a mapped file.
  * Argument: len
- *     Number of elements in the array.
+ *     Number of bytes in text.
+ * Argument: num_threads
+ *     Number of threads to use.
+ * Argument: num_1_4_7_8s
+ *     OUT: Number of 1s, 4s, 7s and 8s in the outputs, for part 1.
+ * Argument: output_sum
+ *     OUT: Sum of the outputs, for part 2.
  *
  * Return: void
  */
 static void
-identify_outputs(note_type *notes, size_t len)
+decode_notes_parallel(char   *text,
+                      size_t  len,
+                      size_t  num_threads,
+                      size_t *num_1_4_7_8s,
+                      size_t *output_sum)
 {
-    size_t i, j, k;
+    note_chunk_type *chunks = NULL;
+    notes_type       notes;
+    int8_t           table[MAX_SIGNATURE + 1];
+    size_t           num_lines;
+    size_t           boundary;
+    size_t           i;
 
-    for (i = 0; i < len; i++) {
-        for (j = 0; j < NUM_OUTPUTS; j++) {
-            /*
-             * Find the string which matches this output in the unique signals
-             * then get it's value from the num array.
-             */
-            k = 0;
-            while (!STRS_EQUAL(notes[i].output[j],
-                               notes[i].unique_signals[k])) {
-                k++;
-            }
-            /* Found the matching string, get it's value */
-            notes[i].output_nums[j] = notes[i].unique_signals_nums[k];
-        }
+    assert(num_threads > 0);
+
+    make_digit_signature_table(table);
+    chunks = malloc_b(num_threads * sizeof(note_chunk_type));
+
+    boundary = 0;
+    for (i = 0; i < num_threads; i++) {
+        chunks[i].text = text;
+        chunks[i].start = boundary;
+        boundary = find_line_boundary(text, len,
+                                      MAX(boundary,
+                                          len * (i + 1) / num_threads));
+        chunks[i].end = boundary;
+        chunks[i].table = table;
     }
+    run_threads(chunks, sizeof(note_chunk_type), num_threads, count_note_chunk);
+
+    num_lines = 0;
+    for (i = 0; i < num_threads; i++) {
+        chunks[i].first_note = num_lines;
+        num_lines += chunks[i].num_lines;
+    }
+    notes = make_notes(num_lines);
+    for (i = 0; i < num_threads; i++) {
+        chunks[i].notes = notes;
+    }
+    run_threads(chunks, sizeof(note_chunk_type), num_threads,
+                decode_note_chunk);
+
+    *num_1_4_7_8s = 0;
+    *output_sum = 0;
+    for (i = 0; i < num_threads; i++) {
+        *num_1_4_7_8s += chunks[i].num_1_4_7_8s;
+        *output_sum += chunks[i].output_sum;
+    }
+
+    free_notes(&notes);
+    free(chunks);
+    chunks = NULL;
 }
 
 /*
- * find_sum_of_outputs
+ * report_scaling
  *
- * Find the sum of all the outputs of the notes.
+ * Time scanning and decoding one note at a time against the parallel version,
+ * for every thread count from 1 to the number of online cores, and check they
+ * agree.
  *
- * Argument: notes
- *     Array of note structs. All output digits must have already been
- *     identified.
- * Argument: len
- *     Number of elements in the array.
+ * Argument: file_name
+ *     File of notes to time on.
  *
- * Return: int
+ * Return: void
  */
-static int
-find_sum_of_outputs(note_type *notes, size_t len)
+static void
+report_scaling(char *file_name)
 {
-    size_t i, j;
-    int    output;
-    int    sum = 0;
+    char            *text = NULL;
+    size_t           text_len;
+    notes_type       notes;
+    int8_t           table[MAX_SIGNATURE + 1];
+    size_t           num_notes;
+    size_t           expected_1, expected_2;
+    size_t           part_1, part_2;
+    size_t           num_threads, max_threads;
+    struct timespec  start_time, end_time;
+    uint64_t         elapsed_ns;
+    char             description[64];
 
-    for (i = 0; i < len; i++) {
-        output = 0;
-        for (j = 0; j < NUM_OUTPUTS; j++) {
-            output *= 10;
-            output += notes[i].output_nums[j];
-        }
-        sum += output;
+    text = map_file(file_name, &text_len);
+    max_threads = MAX(1, sysconf(_SC_NPROCESSORS_ONLN));
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+    make_digit_signature_table(table);
+    notes = make_notes(count_lines(text, text_len));
+    num_notes = scan_notes(text, text_len, notes, 0);
+    decode_notes_scalar(notes, 0, num_notes, table, &expected_1, &expected_2);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+    free_notes(&notes);
+    printf("%zu notes, %zu cores\n", num_notes, max_threads);
+    print_elapsed_time(find_elapsed_time_ns(start_time, end_time), "Serial");
+
+    for (num_threads = 1; num_threads <= max_threads; num_threads++) {
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+        decode_notes_parallel(text, text_len, num_threads, &part_1, &part_2);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+        assert(part_1 == expected_1);
+        assert(part_2 == expected_2);
+        elapsed_ns = find_elapsed_time_ns(start_time, end_time);
+        snprintf(description, sizeof(description),
+                 "Parallel, %zu threads (%.3g notes/s/thread)", num_threads,
+                 num_notes * 1e9 / MAX(1, elapsed_ns) / num_threads);
+        print_elapsed_time(elapsed_ns, description);
     }
 
-    return (sum);
+    munmap(text, text_len);
+    text = NULL;
+}
+
+/*
+ * print_generated_notes
+ *
+ * Print randomly wired notes in the puzzle's input format. Each note has the
+ * ten digits in a random order, then four random output digits. The same
+ * number of notes always gives the same notes.
+ *
+ * Argument: num_notes
+ *     Number of notes to print.
+ *
+ * Return: void
+ */
+static void
+print_generated_notes(size_t num_notes)
+{
+    char        wiring[NUM_SEGMENTS];
+    size_t      order[NUM_UNIQUE_SIGNALS];
+    const char *pattern;
+    size_t      swap;
+    size_t      i, j, k;
+    char        c;
+
+    srand(num_notes);
+
+    for (i = 0; i < num_notes; i++) {
+        /* Shuffle the segments and the order of the unique signals */
+        for (j = 0; j < NUM_SEGMENTS; j++) {
+            wiring[j] = 'a' + j;
+        }
+        for (j = NUM_SEGMENTS - 1; j > 0; j--) {
+            k = rand() % (j + 1);
+            c = wiring[j];
+            wiring[j] = wiring[k];
+            wiring[k] = c;
+        }
+        for (j = 0; j < NUM_UNIQUE_SIGNALS; j++) {
+            order[j] = j;
+        }
+        for (j = NUM_UNIQUE_SIGNALS - 1; j > 0; j--) {
+            k = rand() % (j + 1);
+            swap = order[j];
+            order[j] = order[k];
+            order[k] = swap;
+        }
+
+        for (j = 0; j < NUM_UNIQUE_SIGNALS + NUM_OUTPUTS; j++) {
+            if (j < NUM_UNIQUE_SIGNALS) {
+                pattern = DIGIT_PATTERNS[order[j]];
+            } else {
+                pattern = DIGIT_PATTERNS[rand() % NUM_UNIQUE_SIGNALS];
+            }
+            if (j == NUM_UNIQUE_SIGNALS) {
+                printf("| ");
+            }
+            for (; *pattern != '\0'; pattern++) {
+                putchar(wiring[*pattern - 'a']);
+            }
+            putchar(j == NUM_UNIQUE_SIGNALS + NUM_OUTPUTS - 1 ? '\n' : ' ');
+        }
+    }
 }
 
 /*
@@ -399,41 +1014,50 @@ find_sum_of_outputs(note_type *notes, size_t len)
 static void
 runner(char *file_name, bool print_output)
 {
-    parsed_text_type  parsed_text;
-    size_t            num_1_4_7_8s;
-    note_type        *notes = NULL;
-    int               output_sum;
+    char   *text = NULL;
+    size_t  text_len;
+    size_t  num_1_4_7_8s;
+    size_t  output_sum;
 
-    parsed_text = parse_file(file_name);
+    text = read_file_to_buffer(file_name, &text_len);
 
-    notes = parse_text_into_note_types(parsed_text);
-
-    num_1_4_7_8s = find_num_1_4_7_8_in_output(notes, parsed_text.num_lines);
+    decode_notes_parallel(text, text_len,
+                          find_num_threads(text_len, MIN_BYTES_PER_THREAD),
+                          &num_1_4_7_8s, &output_sum);
     if (print_output) {
         printf("Part 1: Number of 1,4,7,8s = %zu\n", num_1_4_7_8s);
+        printf("Part 2: Sum of outputs = %zu\n", output_sum);
     }
 
-    identify_1_4_7_8s(notes, parsed_text.num_lines);
-    identify_0_2_3_5_6_9s(notes, parsed_text.num_lines);
-    identify_outputs(notes, parsed_text.num_lines);
-    output_sum = find_sum_of_outputs(notes, parsed_text.num_lines);
-    if (print_output) {
-        printf("Part 2: Sum of outputs = %d\n", output_sum);
-    }
-
-    free(notes);
-    notes = NULL;
-    free_parsed_text(parsed_text);
+    free(text);
+    text = NULL;
 }
 
 /*
  * Main function.
+ *
+ * Usage:
+ *   day_08 <file>
+ *       Solve both parts.
+ *   day_08 --scaling <file>
+ *       Time the serial and parallel versions for 1 to all cores.
+ *   day_08 --generate <num_notes>
+ *       Print num_notes randomly wired notes.
  */
 int
 main(int argc, char **argv)
 {
     char *file_name = NULL;
 
+    if (argc == 3 && STRS_EQUAL(argv[1], "--scaling")) {
+        report_scaling(argv[2]);
+        return (0);
+    }
+    if (argc == 3 && STRS_EQUAL(argv[1], "--generate")) {
+        print_generated_notes(strtoul(argv[2], NULL, 10));
+        return (0);
+    }
+
     assert(argc == 2);
     file_name = argv[1];
 
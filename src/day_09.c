@@ -2,46 +2,191 @@
  * AoC 2021 Day 9 solution
  */
 
+#include <immintrin.h>
+#include <unistd.h>
+
 #include "utils.h"
 
-/*
- * height_type
- *
- * Element: height
- *     Height of the area.
- * Element: is_low_point
- *     Whether this area is a low point or not (has no adjacent areas which
- *     are higher).
- * Element: basin_low_point
- *     Pointer to the low point of the basin this area is in. Will be NULL for
- *     heights of 9 as they are not in any basins.
- * Element: basin_size
- *     Size of the basin. This is only set for low-points, all other points
- *     will be 0.
- */
-typedef struct Height {
-    uint8_t        height;
-    bool           is_low_point;
-    struct Height *basin_low_point;
-    size_t         basin_size;
-} height_type;
+/* Height of the walls between basins */
+#define WALL_HEIGHT 9
+
+/* Label of areas which are not in any basin */
+#define NO_BASIN UINT32_MAX
+
+/* Number of largest basins to multiply together for part 2 */
+#define NUM_LARGEST_BASINS 3
+
+/* Number of heights compared at once by the AVX2 version */
+#define AVX2_HEIGHTS_PER_VECTOR 32
+
+/* Number of low point flags in each word of the low point bitmask */
+#define LOW_POINTS_PER_WORD 32
+
+/* Fewest areas worth giving a thread of their own when labelling basins */
+#define MIN_AREAS_PER_THREAD (1 << 18)
 
 /*
  * height_map_type
  *
- * Element: height_map
- *     2D array of the entire area, where each element is a height_type.
+ * Heights stored as one contiguous plane, padded by a border of walls on every
+ * side so neighbours can be read without bounds checks. Each padded row is
+ * long enough to read a whole vector from any area in it.
+ *
+ * Element: heights
+ *     Plane of heights. Area (x, y) is at heights[(y + 1) * stride + x + 1].
+ * Element: stride
+ *     Number of heights in each padded row, a multiple of
+ *     AVX2_HEIGHTS_PER_VECTOR.
  * Element: length
- *     How long the area is (number of elements in first array).
+ *     How long the area is (number of rows).
  * Element: width
- *     How wide the area is (number of elements in second array).
+ *     How wide the area is (number of areas in each row).
+ * Element: low_points
+ *     Bitmask of the low points (areas lower than every adjacent area). Bit
+ *     x % 32 of word y * stride / 32 + x / 32 is area (x, y).
  */
 typedef struct Height_Map {
-    height_type **height_map;
-    size_t        length;
-    size_t        width;
+    uint8_t  *heights;
+    size_t    stride;
+    size_t    length;
+    size_t    width;
+    uint32_t *low_points;
 } height_map_type;
 
+/*
+ * basins_type
+ *
+ * Basins of a height map, as the connected areas between walls of height
+ * WALL_HEIGHT.
+ *
+ * Element: labels
+ *     Label of each area, laid out as the padded height plane, or NO_BASIN for
+ *     walls and padding. Several labels can belong to one basin.
+ * Element: basin_of_label
+ *     Basin of each label.
+ * Element: num_labels
+ *     Number of labels.
+ * Element: sizes
+ *     Number of areas in each basin.
+ * Element: num_basins
+ *     Number of basins.
+ */
+typedef struct Basins {
+    uint32_t *labels;
+    uint32_t *basin_of_label;
+    size_t    num_labels;
+    size_t   *sizes;
+    size_t    num_basins;
+} basins_type;
+
+/*
+ * basin_strip_type
+ *
+ * Work for one thread of a parallel labelling, a strip of whole rows of the
+ * height map. Each strip gives out labels from its own range, starting at the
+ * index of its first area, so strips never share a label.
+ *
+ * Element: height_map
+ *     Height map being labelled.
+ * Element: labels
+ *     Padded plane of labels shared by every strip.
+ * Element: parents
+ *     Union-find parent of each label, shared by every strip.
+ * Element: label_sizes
+ *     Number of areas under each root label, shared by every strip.
+ * Element: basin_of_label
+ *     Root, then basin, of each label, shared by every strip.
+ * Element: basin_sizes
+ *     Size of each basin, shared by every strip.
+ * Element: first_row
+ *     First row of the strip.
+ * Element: end_row
+ *     One past the last row of the strip.
+ * Element: first_label
+ *     First label of the strip's range.
+ * Element: num_labels
+ *     Number of labels the strip gave out.
+ * Element: num_basins
+ *     Number of root labels in the strip once strips are joined.
+ * Element: first_basin
+ *     Basin number of the strip's first root label.
+ */
+typedef struct Basin_Strip {
+    height_map_type  height_map;
+    uint32_t        *labels;
+    uint32_t        *parents;
+    size_t          *label_sizes;
+    uint32_t        *basin_of_label;
+    size_t          *basin_sizes;
+    size_t           first_row;
+    size_t           end_row;
+    uint32_t         first_label;
+    size_t           num_labels;
+    size_t           num_basins;
+    size_t           first_basin;
+} basin_strip_type;
+
+/*
+ * basin_stream_type
+ *
+ * State for finding low points and basins over a stream of rows, holding
+ * only the last two rows. Basins still touching the last row are open, with
+ * their labels in a union-find of slots which are reused once closed.
+ *
+ * Element: width
+ *     Number of areas in each row.
+ * Element: num_rows
+ *     Number of rows added so far.
+ * Element: rows
+ *     The previous and current rows of heights, each padded by a wall at both
+ *     ends.
+ * Element: labels
+ *     Slot of the basin of each area in the previous and current rows, padded
+ *     as rows, or NO_BASIN for walls.
+ * Element: is_candidate
+ *     Whether each area of the previous row is lower than the areas to its
+ *     left, right and above, so is a low point if it is also lower than the
+ *     area below.
+ * Element: parents
+ *     Parent of each slot. Roots are their own parent.
+ * Element: sizes
+ *     Number of areas in the basin of each root slot.
+ * Element: roots
+ *     Root of each live slot, found once each row.
+ * Element: last_row
+ *     Last row each root slot was seen in.
+ * Element: live_slots
+ *     Slots in use.
+ * Element: num_live_slots
+ *     Number of elements in live_slots.
+ * Element: free_slots
+ *     Stack of slots not in use.
+ * Element: num_free_slots
+ *     Number of elements in free_slots.
+ * Element: largest_sizes
+ *     Sizes of the NUM_LARGEST_BASINS largest closed basins, largest first,
+ *     with 0 for none.
+ * Element: total_risk_level
+ *     Sum of the risk levels of the low points found so far.
+ */
+typedef struct Basin_Stream {
+    size_t    width;
+    size_t    num_rows;
+    uint8_t  *rows[2];
+    uint32_t *labels[2];
+    bool     *is_candidate;
+    uint32_t *parents;
+    size_t   *sizes;
+    uint32_t *roots;
+    size_t   *last_row;
+    uint32_t *live_slots;
+    size_t    num_live_slots;
+    uint32_t *free_slots;
+    size_t    num_free_slots;
+    size_t    largest_sizes[NUM_LARGEST_BASINS];
+    size_t    total_risk_level;
+} basin_stream_type;
+
 /*
  * free_height_map
  *
@@ -54,26 +199,51 @@ typedef struct Height_Map {
  *
  */
 static void
-free_height_map(height_map_type height_map)
+free_height_map(height_map_type *height_map)
 {
-    size_t i;
+    free(height_map->low_points);
+    height_map->low_points = NULL;
+    free(height_map->heights);
+    height_map->heights = NULL;
+}
 
-    if (height_map.height_map != NULL) {
-        for (i = 0; i < height_map.length; i++) {
-            free(height_map.height_map[i]);
-            height_map.height_map[i] = NULL;
-        }
-        free(height_map.height_map);
-        height_map.height_map = NULL;
-        height_map.length = 0;
-        height_map.width = 0;
-    }
+/*
+ * make_height_map
+ *
+ * Make a height map of all walls, to have its areas filled in.
+ *
+ * Argument: width
+ *     How wide the area is (number of areas in each row).
+ * Argument: length
+ *     How long the area is (number of rows).
+ *
+ * Return: height_map_type
+ */
+static height_map_type
+make_height_map(size_t width, size_t length)
+{
+    size_t          num_words;
+    height_map_type height_map;
+
+    height_map.width = width;
+    height_map.length = length;
+    /* Room for both borders and a vector read from the last area */
+    height_map.stride = (height_map.width + 2 * AVX2_HEIGHTS_PER_VECTOR)
+                        / AVX2_HEIGHTS_PER_VECTOR * AVX2_HEIGHTS_PER_VECTOR;
+    height_map.heights = malloc_b((height_map.length + 2) * height_map.stride);
+    memset(height_map.heights, WALL_HEIGHT,
+           (height_map.length + 2) * height_map.stride);
+
+    num_words = height_map.length * height_map.stride / LOW_POINTS_PER_WORD;
+    height_map.low_points = calloc_b(MAX(1, num_words), sizeof(uint32_t));
+
+    return (height_map);
 }
 
 /*
  * parse_text_into_height_map
  *
- * Parse lines of notes into an array of note_type structs.
+ * Parse lines of digits into a padded height plane.
  *
  * Argument: parsed_text
  *     Parsed text struct from the day's input.
@@ -84,268 +254,1136 @@ static height_map_type
 parse_text_into_height_map(parsed_text_type parsed_text)
 {
     size_t          i, j;
+    uint8_t        *row;
     height_map_type height_map;
 
-    height_map.width = strlen(parsed_text.lines[0].line);
-    height_map.length = parsed_text.num_lines;
-    height_map.height_map = malloc_b(height_map.length
-                                     * sizeof(height_type *));
+    height_map = make_height_map(strlen(parsed_text.lines[0].line),
+                                 parsed_text.num_lines);
 
-    for (i = 0; i < parsed_text.num_lines; i++) {
-        height_map.height_map[i] = calloc_b(height_map.width,
-                                            sizeof(height_type));
+    for (i = 0; i < height_map.length; i++) {
+        assert(strlen(parsed_text.lines[i].line) == height_map.width);
+        row = &(height_map.heights[(i + 1) * height_map.stride + 1]);
         for (j = 0; j < height_map.width; j++) {
-            height_map.height_map[i][j].height =
-                                (uint8_t) (parsed_text.lines[i].line[j] - '0');
+            row[j] = (uint8_t) (parsed_text.lines[i].line[j] - '0');
         }
     }
 
     return (height_map);
 }
 
-
 /*
- * identify_low_points
+ * find_low_points_scalar
  *
- * Identify low points in the height map.
+ * Find the low points of the height map, one area at a time.
  *
  * Argument: height_map
- *     Height map to identify low points of.
+ *     Height map to find the low points of. Its low point bitmask is filled
+ *     in.
  *
- * Return: void
+ * Return: size_t
+ *     Sum of the risk levels (height + 1) of the low points.
  */
-static void
-identify_low_points(height_map_type height_map)
+static size_t
+find_low_points_scalar(height_map_type height_map)
 {
-    size_t i, j;
-    bool   is_low_point;
+    size_t   total_risk_level = 0;
+    size_t   words_per_row = height_map.stride / LOW_POINTS_PER_WORD;
+    uint8_t *area;
+    size_t   i, j;
 
     for (i = 0; i < height_map.length; i++) {
-        for (j = 0; j < height_map.width; j++) {
-            /*
-             * Check each adjacent square in turn to see if it is lower than
-             * the current area. If any are lower then this is not a low point.
-             */
-            is_low_point = true;
-            if (i != 0) {
-                /* Check above */
-                is_low_point = (height_map.height_map[i][j].height
-                                < height_map.height_map[i-1][j].height);
-            }
-            if (is_low_point && i != (height_map.length - 1)) {
-                /* Check below */
-                is_low_point = (height_map.height_map[i][j].height
-                                < height_map.height_map[i+1][j].height);
-            }
-            if (is_low_point && j != 0) {
-                /* Check left */
-                is_low_point = (height_map.height_map[i][j].height
-                                < height_map.height_map[i][j-1].height);
-            }
-            if (is_low_point && j != (height_map.width - 1)) {
-                /* Check right */
-                is_low_point = (height_map.height_map[i][j].height
-                                < height_map.height_map[i][j+1].height);
+        area = &(height_map.heights[(i + 1) * height_map.stride + 1]);
+        for (j = 0; j < height_map.width; j++, area++) {
+            if (area[0] < area[-1] && area[0] < area[1]
+                && area[0] < *(area - height_map.stride)
+                && area[0] < *(area + height_map.stride)) {
+                height_map.low_points[i * words_per_row
+                                      + j / LOW_POINTS_PER_WORD] |=
+                                    UINT32_C(1) << (j % LOW_POINTS_PER_WORD);
+                total_risk_level += area[0] + 1;
             }
-            height_map.height_map[i][j].is_low_point = is_low_point;
         }
     }
+
+    return (total_risk_level);
 }
 
 /*
- * find_sum_of_risk_levels_of_low_points
+ * find_low_points_avx2
  *
- * Find the sum of the risk levels of all the low points in the height map. The
- * risk level of a point is the height+1.
+ * AVX2 version of find_low_points_scalar(), comparing
+ * AVX2_HEIGHTS_PER_VECTOR areas of a row at a time against the row shifted
+ * left and right and the rows above and below. The risk levels of the low
+ * points are summed in the same pass.
  *
  * Argument: height_map
- *     Height map. Low points already be identified.
+ *     Height map to find the low points of. Its low point bitmask is filled
+ *     in.
  *
- * Return: void
+ * Return: size_t
+ *     Sum of the risk levels (height + 1) of the low points.
  */
+__attribute__((target("avx2")))
 static size_t
-find_sum_of_risk_levels_of_low_points(height_map_type height_map)
+find_low_points_avx2(height_map_type height_map)
 {
-    size_t i, j;
-    size_t total_risk_level = 0;
+    __m256i   positions = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+                                           11, 12, 13, 14, 15, 16, 17, 18,
+                                           19, 20, 21, 22, 23, 24, 25, 26,
+                                           27, 28, 29, 30, 31);
+    __m256i   risk_sums = _mm256_setzero_si256();
+    __m256i   area, is_low;
+    uint64_t  lanes[4];
+    size_t    words_per_row = height_map.stride / LOW_POINTS_PER_WORD;
+    uint8_t  *row;
+    size_t    i, j;
 
     for (i = 0; i < height_map.length; i++) {
-        for (j = 0; j < height_map.width; j++) {
-            if (height_map.height_map[i][j].is_low_point) {
-                total_risk_level += height_map.height_map[i][j].height + 1;
+        row = &(height_map.heights[(i + 1) * height_map.stride + 1]);
+        for (j = 0; j < height_map.width; j += AVX2_HEIGHTS_PER_VECTOR) {
+            /* Heights are at most 9, so signed compares are safe */
+            area = _mm256_loadu_si256((__m256i *) &row[j]);
+            is_low = _mm256_and_si256(
+                 _mm256_and_si256(
+                      _mm256_cmpgt_epi8(
+                           _mm256_loadu_si256((__m256i *) &row[j - 1]), area),
+                      _mm256_cmpgt_epi8(
+                           _mm256_loadu_si256((__m256i *) &row[j + 1]), area)),
+                 _mm256_and_si256(
+                      _mm256_cmpgt_epi8(
+                           _mm256_loadu_si256(
+                                (__m256i *) &row[j - height_map.stride]),
+                           area),
+                      _mm256_cmpgt_epi8(
+                           _mm256_loadu_si256(
+                                (__m256i *) &row[j + height_map.stride]),
+                           area)));
+            if (height_map.width - j < AVX2_HEIGHTS_PER_VECTOR) {
+                /* Drop the areas past the end of the row */
+                is_low = _mm256_and_si256(
+                        is_low,
+                        _mm256_cmpgt_epi8(
+                                _mm256_set1_epi8(height_map.width - j),
+                                positions));
             }
+            height_map.low_points[i * words_per_row
+                                  + j / LOW_POINTS_PER_WORD] =
+                                                _mm256_movemask_epi8(is_low);
+            risk_sums = _mm256_add_epi64(
+                    risk_sums,
+                    _mm256_sad_epu8(
+                            _mm256_and_si256(is_low,
+                                             _mm256_add_epi8(
+                                                  area, _mm256_set1_epi8(1))),
+                            _mm256_setzero_si256()));
         }
     }
 
-    return (total_risk_level);
+    _mm256_storeu_si256((__m256i *) lanes, risk_sums);
+
+    return (lanes[0] + lanes[1] + lanes[2] + lanes[3]);
 }
 
 /*
- * find_basin_low_point_area_is_in
+ * find_low_points
  *
- * For a given area (at height_map.height_map[y][x]), find the low point of the
- * basin the area is in.
+ * Find the low points of the height map and the sum of their risk levels.
+ * Uses AVX2 if the CPU supports it.
  *
  * Argument: height_map
- *     Height map the area is in.
- * Argument: area_x_pos
- *     x position of the area.
- * Argument: area_y_pos
- *     y position of the area.
- *
- * Return: height_type *
- */
-static height_type *
-find_basin_low_point_area_is_in(height_map_type height_map,
-                                size_t          area_x_pos,
-                                size_t          area_y_pos)
+ *     Height map to find the low points of. Its low point bitmask is filled
+ *     in.
+ *
+ * Return: size_t
+ *     Sum of the risk levels (height + 1) of the low points.
+ */
+static size_t
+find_low_points(height_map_type height_map)
 {
-    height_type  area;
-    uint8_t      lowest_adjacent_height;
+    if (__builtin_cpu_supports("avx2")) {
+        return (find_low_points_avx2(height_map));
+    }
+
+    return (find_low_points_scalar(height_map));
+}
+
+/*
+ * find_label_root
+ *
+ * Find the root of a label's set, halving the path to it on the way.
+ *
+ * Argument: parents
+ *     Parent of each label. Roots are their own parent.
+ * Argument: label
+ *     Label to find the root of.
+ *
+ * Return: uint32_t
+ */
+static uint32_t
+find_label_root(uint32_t *parents, uint32_t label)
+{
+    while (parents[label] != label) {
+        parents[label] = parents[parents[label]];
+        label = parents[label];
+    }
+
+    return (label);
+}
+
+/*
+ * union_labels
+ *
+ * Join the sets of two labels, with the larger set's root as the new root.
+ *
+ * Argument: parents
+ *     Parent of each label. Roots are their own parent.
+ * Argument: sizes
+ *     Number of areas in the set of each root.
+ * Argument: a
+ *     First label.
+ * Argument: b
+ *     Second label.
+ *
+ * Return: uint32_t
+ *     Root of the joined set.
+ */
+static uint32_t
+union_labels(uint32_t *parents, size_t *sizes, uint32_t a, uint32_t b)
+{
+    uint32_t swap;
+
+    a = find_label_root(parents, a);
+    b = find_label_root(parents, b);
+    if (a == b) {
+        return (a);
+    }
+    if (sizes[a] < sizes[b]) {
+        swap = a;
+        a = b;
+        b = swap;
+    }
+    parents[b] = a;
+    sizes[a] += sizes[b];
+
+    return (a);
+}
+
+/*
+ * label_basins
+ *
+ * Label the basins of a height map in a single raster scan. Each area which
+ * is not a wall joins the label of the area to its left and the one above,
+ * making a new label if neither is in a basin, and the labels of both are
+ * joined with a union-find if they differ. The size of each basin is kept on
+ * the root of its labels as the scan goes. The roots are then numbered to
+ * give the basins.
+ *
+ * Argument: height_map
+ *     Height map to label.
+ *
+ * Return: basins_type
+ */
+static basins_type
+label_basins(height_map_type height_map)
+{
+    basins_type  basins;
+    uint32_t    *parents = NULL;
+    size_t      *label_sizes = NULL;
+    uint32_t    *labels = NULL;
+    uint32_t     left, above, label;
+    size_t       num_areas = height_map.length * height_map.width;
+    size_t       plane_size = (height_map.length + 2) * height_map.stride;
+    size_t       index;
     size_t       i, j;
-    size_t       i_lowest, j_lowest;
-
-    area = height_map.height_map[area_y_pos][area_x_pos];
-    if (area.height == 9) {
-        /* Areas with height 9 are not in basins */
-        return (NULL);
-    }
-
-    /*
-     * Start at the given area and check adjacent areas for the lowest. Then
-     * start from this new lowest and continue until we find a low point.
-     */
-    i = area_y_pos;
-    j = area_x_pos;
-    while (!height_map.height_map[i][j].is_low_point) {
-        /*
-         * Find the lowest adjacent area.
-         */
-        lowest_adjacent_height = 9;
-        /* Check above */
-        if (i != 0
-            && height_map.height_map[i-1][j].height < lowest_adjacent_height) {
-            /* Above is lower than current lowest */
-            i_lowest = i - 1;
-            j_lowest = j;
-            lowest_adjacent_height =
-                              height_map.height_map[i_lowest][j_lowest].height;
-        }
-        /* Check below */
-        if (i != (height_map.length - 1)
-            && height_map.height_map[i+1][j].height < lowest_adjacent_height) {
-            /* Below is lower than current lowest */
-            i_lowest = i + 1;
-            j_lowest = j;
-            lowest_adjacent_height =
-                              height_map.height_map[i_lowest][j_lowest].height;
-        }
-        /* Check left */
-        if (j != 0
-            && height_map.height_map[i][j-1].height < lowest_adjacent_height) {
-            /* Left is lower than current lowest */
-            i_lowest = i;
-            j_lowest = j - 1;
-            lowest_adjacent_height =
-                              height_map.height_map[i_lowest][j_lowest].height;
+
+    assert(num_areas < NO_BASIN);
+
+    /* The padding is all walls, so never joins a basin */
+    labels = malloc_b(plane_size * sizeof(uint32_t));
+    memset(labels, 0xff, plane_size * sizeof(uint32_t));
+    parents = malloc_b(MAX(1, num_areas) * sizeof(uint32_t));
+    label_sizes = malloc_b(MAX(1, num_areas) * sizeof(size_t));
+    basins.num_labels = 0;
+
+    for (i = 0; i < height_map.length; i++) {
+        index = (i + 1) * height_map.stride + 1;
+        for (j = 0; j < height_map.width; j++, index++) {
+            if (height_map.heights[index] == WALL_HEIGHT) {
+                continue;
+            }
+            left = labels[index - 1];
+            above = labels[index - height_map.stride];
+            if (left == NO_BASIN && above == NO_BASIN) {
+                /* Start a new label */
+                label = basins.num_labels++;
+                parents[label] = label;
+                label_sizes[label] = 0;
+            } else if (left == NO_BASIN) {
+                label = above;
+            } else if (above == NO_BASIN || above == left) {
+                label = left;
+            } else {
+                union_labels(parents, label_sizes, left, above);
+                label = left;
+            }
+            labels[index] = label;
+            label_sizes[find_label_root(parents, label)]++;
         }
-        /* Check right */
-        if (j != (height_map.width - 1)
-            && height_map.height_map[i][j+1].height < lowest_adjacent_height) {
-            /* Right is lower than current lowest */
-            i_lowest = i;
-            j_lowest = j + 1;
-            lowest_adjacent_height =
-                              height_map.height_map[i_lowest][j_lowest].height;
+    }
+
+    /* Number the roots, then give every label its root's basin */
+    basins.labels = labels;
+    basins.basin_of_label = malloc_b(MAX(1, basins.num_labels)
+                                     * sizeof(uint32_t));
+    basins.sizes = malloc_b(MAX(1, basins.num_labels) * sizeof(size_t));
+    basins.num_basins = 0;
+    for (i = 0; i < basins.num_labels; i++) {
+        if (parents[i] == i) {
+            basins.basin_of_label[i] = basins.num_basins;
+            basins.sizes[basins.num_basins++] = label_sizes[i];
         }
-        /* Set the next area to try */
-        i = i_lowest;
-        j = j_lowest;
+    }
+    for (i = 0; i < basins.num_labels; i++) {
+        basins.basin_of_label[i] =
+                     basins.basin_of_label[find_label_root(parents, i)];
     }
 
-    return (&(height_map.height_map[i][j]));
+    free(label_sizes);
+    label_sizes = NULL;
+    free(parents);
+    parents = NULL;
+
+    return (basins);
 }
 
 /*
- * identify_basins
+ * free_basins
  *
- * Identify the basin each area is in and set the size of each basin for each
- * low-point.
+ * Free allocated memory from the basins struct.
  *
- * Argument: height_map
- *     Height map to identify basins of.
+ * Argument: basins
+ *     basins_type struct to free.
  *
  * Return: void
  */
 static void
-identify_basins(height_map_type height_map)
+free_basins(basins_type *basins)
 {
-    size_t       i, j;
+    free(basins->sizes);
+    basins->sizes = NULL;
+    free(basins->basin_of_label);
+    basins->basin_of_label = NULL;
+    free(basins->labels);
+    basins->labels = NULL;
+}
 
-    for (i = 0; i < height_map.length; i++) {
-        for (j = 0; j < height_map.width; j++) {
-            height_map.height_map[i][j].basin_low_point =
-                             find_basin_low_point_area_is_in(height_map, j, i);
-            if (height_map.height_map[i][j].basin_low_point != NULL) {
-                height_map.height_map[i][j].basin_low_point->basin_size++;
+/*
+ * select_largest_sizes
+ *
+ * Partially order sizes so the k largest come first, in no particular order,
+ * with a quickselect. Takes linear time on average rather than sorting.
+ *
+ * Argument: sizes
+ *     Array of sizes to reorder.
+ * Argument: num_sizes
+ *     Number of elements in the array.
+ * Argument: k
+ *     Number of largest sizes to move to the front.
+ *
+ * Return: void
+ */
+static void
+select_largest_sizes(size_t *sizes, size_t num_sizes, size_t k)
+{
+    size_t low = 0;
+    size_t high = num_sizes;
+    size_t pivot, swap;
+    size_t store, i;
+
+    while (k > low && k < high) {
+        /* Partition around the middle element, largest first */
+        swap = sizes[low + (high - low) / 2];
+        sizes[low + (high - low) / 2] = sizes[high - 1];
+        sizes[high - 1] = swap;
+        pivot = sizes[high - 1];
+        store = low;
+        for (i = low; i < high - 1; i++) {
+            if (sizes[i] > pivot) {
+                swap = sizes[i];
+                sizes[i] = sizes[store];
+                sizes[store++] = swap;
             }
         }
+        sizes[high - 1] = sizes[store];
+        sizes[store] = pivot;
+
+        if (store < k) {
+            low = store + 1;
+        } else {
+            high = store;
+        }
     }
 }
 
 /*
- * find_3_largest_basin_sizes_multiplied
+ * find_largest_basin_sizes_multiplied
  *
- * Multiply the 3 largest basin sizes together for part 2.
+ * Multiply the NUM_LARGEST_BASINS largest basin sizes together for part 2.
  *
- * Argument: height_map
- *     Height map. The sizes of each basin must already be identified.
+ * Argument: basins
+ *     Labelled basins. Their sizes are reordered.
  *
  * Return: size_t
  */
 static size_t
-find_3_largest_basin_sizes_multiplied(height_map_type height_map)
+find_largest_basin_sizes_multiplied(basins_type basins)
 {
-    size_t  i, j, k;
-    size_t  num_basins;
-    int    *basin_sizes = NULL;
-    size_t  largest_basins_multipled;
+    size_t largest_basins_multipled = 1;
+    size_t i;
 
-    /*
-     * First find the number of basins, then add the basin sizes to an array
-     * of integers, sort it and return the 3 largest sizes multiplied together.
-     */
+    assert(basins.num_basins >= NUM_LARGEST_BASINS);
 
-    num_basins = 0;
-    for (i = 0; i < height_map.length; i++) {
-        for (j = 0; j < height_map.width; j++) {
-            if (height_map.height_map[i][j].is_low_point) {
-                num_basins++;
+    select_largest_sizes(basins.sizes, basins.num_basins, NUM_LARGEST_BASINS);
+    for (i = 0; i < NUM_LARGEST_BASINS; i++) {
+        largest_basins_multipled *= basins.sizes[i];
+    }
+
+    return (largest_basins_multipled);
+}
+
+/*
+ * label_basin_strip
+ *
+ * Thread function to label the basins of one strip as label_basins does,
+ * without looking above its first row, then point every label straight at
+ * its root. Unions only join labels of the strip's own range.
+ *
+ * Argument: arg
+ *     Pointer to the basin_strip_type to label.
+ *
+ * Return: void *
+ */
+static void *
+label_basin_strip(void *arg)
+{
+    basin_strip_type *strip = arg;
+    height_map_type   height_map = strip->height_map;
+    uint32_t         *labels = strip->labels;
+    uint32_t         *parents = strip->parents;
+    size_t           *label_sizes = strip->label_sizes;
+    uint32_t          left, above, label;
+    size_t            index;
+    size_t            i, j;
+
+    strip->num_labels = 0;
+    for (i = strip->first_row; i < strip->end_row; i++) {
+        index = (i + 1) * height_map.stride + 1;
+        for (j = 0; j < height_map.width; j++, index++) {
+            if (height_map.heights[index] == WALL_HEIGHT) {
+                continue;
             }
+            left = labels[index - 1];
+            /* The row above belongs to another strip, joined later */
+            above = (i == strip->first_row) ? NO_BASIN
+                                            : labels[index - height_map.stride];
+            if (left == NO_BASIN && above == NO_BASIN) {
+                /* Start a new label */
+                label = strip->first_label + strip->num_labels++;
+                parents[label] = label;
+                label_sizes[label] = 0;
+            } else if (left == NO_BASIN) {
+                label = above;
+            } else if (above == NO_BASIN || above == left) {
+                label = left;
+            } else {
+                union_labels(parents, label_sizes, left, above);
+                label = left;
+            }
+            labels[index] = label;
+            label_sizes[find_label_root(parents, label)]++;
         }
     }
 
-    basin_sizes = malloc_b(num_basins * sizeof(int));
-    k = 0;
-    for (i = 0; i < height_map.length; i++) {
-        for (j = 0; j < height_map.width; j++) {
-            if (height_map.height_map[i][j].is_low_point) {
-                basin_sizes[k++] = height_map.height_map[i][j].basin_size;
+    for (i = 0; i < strip->num_labels; i++) {
+        label = strip->first_label + i;
+        parents[label] = find_label_root(parents, label);
+    }
+
+    return (NULL);
+}
+
+/*
+ * find_basin_strip_roots
+ *
+ * Thread function to find the root of every label of a strip once the
+ * strips are joined, and count the strip's roots. The parents are only read,
+ * as the roots of other strips are shared.
+ *
+ * Argument: arg
+ *     Pointer to the basin_strip_type.
+ *
+ * Return: void *
+ */
+static void *
+find_basin_strip_roots(void *arg)
+{
+    basin_strip_type *strip = arg;
+    uint32_t          label, root;
+    size_t            i;
+
+    strip->num_basins = 0;
+    for (i = 0; i < strip->num_labels; i++) {
+        label = strip->first_label + i;
+        for (root = label; strip->parents[root] != root;
+             root = strip->parents[root]) {
+        }
+        strip->basin_of_label[label] = root;
+        strip->num_basins += (root == label);
+    }
+
+    return (NULL);
+}
+
+/*
+ * number_basin_strip_roots
+ *
+ * Thread function to number the root labels of a strip as basins, from the
+ * strip's first basin, and record their sizes. The basin replaces the root's
+ * parent, which is no longer needed.
+ *
+ * Argument: arg
+ *     Pointer to the basin_strip_type.
+ *
+ * Return: void *
+ */
+static void *
+number_basin_strip_roots(void *arg)
+{
+    basin_strip_type *strip = arg;
+    size_t            basin = strip->first_basin;
+    uint32_t          label;
+    size_t            i;
+
+    for (i = 0; i < strip->num_labels; i++) {
+        label = strip->first_label + i;
+        if (strip->basin_of_label[label] == label) {
+            strip->basin_sizes[basin] = strip->label_sizes[label];
+            strip->parents[label] = basin++;
+        }
+    }
+
+    return (NULL);
+}
+
+/*
+ * number_basin_strip_labels
+ *
+ * Thread function to give every label of a strip the basin of its root.
+ *
+ * Argument: arg
+ *     Pointer to the basin_strip_type.
+ *
+ * Return: void *
+ */
+static void *
+number_basin_strip_labels(void *arg)
+{
+    basin_strip_type *strip = arg;
+    uint32_t          label;
+    size_t            i;
+
+    for (i = 0; i < strip->num_labels; i++) {
+        label = strip->first_label + i;
+        strip->basin_of_label[label] =
+                     strip->parents[strip->basin_of_label[label]];
+    }
+
+    return (NULL);
+}
+
+/*
+ * label_basins_parallel
+ *
+ * Label the basins of a height map with the rows split into a strip per
+ * thread. Each strip is labelled on its own, then the labels either side of
+ * each boundary between strips are joined with the union-find, summing their
+ * sizes onto the joined roots. Finally the roots are counted and numbered per
+ * strip, with a prefix sum of the counts giving each strip its first basin.
+ *
+ * Argument: height_map
+ *     Height map to label.
+ * Argument: num_threads
+ *     Number of threads to use.
+ *
+ * Return: basins_type
+ *     As from label_basins, except labels are spread over the range of every
+ *     area, and basin_of_label is only set for labels given out.
+ */
+static basins_type
+label_basins_parallel(height_map_type height_map, size_t num_threads)
+{
+    basins_type       basins;
+    basin_strip_type *strips = NULL;
+    uint32_t         *parents = NULL;
+    size_t           *label_sizes = NULL;
+    uint32_t          above, below;
+    size_t            num_areas = height_map.length * height_map.width;
+    size_t            plane_size = (height_map.length + 2) * height_map.stride;
+    size_t            index;
+    size_t            i, j;
+
+    assert(num_areas < NO_BASIN);
+    assert(num_threads > 0);
+    num_threads = MAX(1, MIN(num_threads, height_map.length));
+
+    basins.labels = malloc_b(plane_size * sizeof(uint32_t));
+    memset(basins.labels, 0xff, plane_size * sizeof(uint32_t));
+    basins.basin_of_label = malloc_b(MAX(1, num_areas) * sizeof(uint32_t));
+    basins.num_labels = num_areas;
+    parents = malloc_b(MAX(1, num_areas) * sizeof(uint32_t));
+    label_sizes = malloc_b(MAX(1, num_areas) * sizeof(size_t));
+
+    strips = malloc_b(num_threads * sizeof(basin_strip_type));
+    for (i = 0; i < num_threads; i++) {
+        strips[i].height_map = height_map;
+        strips[i].labels = basins.labels;
+        strips[i].parents = parents;
+        strips[i].label_sizes = label_sizes;
+        strips[i].basin_of_label = basins.basin_of_label;
+        strips[i].first_row = height_map.length * i / num_threads;
+        strips[i].end_row = height_map.length * (i + 1) / num_threads;
+        strips[i].first_label = strips[i].first_row * height_map.width;
+    }
+    run_threads(strips, sizeof(basin_strip_type), num_threads,
+                label_basin_strip);
+
+    /* Join each strip's first row to the row above it */
+    for (i = 1; i < num_threads; i++) {
+        index = (strips[i].first_row + 1) * height_map.stride + 1;
+        for (j = 0; j < height_map.width; j++, index++) {
+            above = basins.labels[index - height_map.stride];
+            below = basins.labels[index];
+            if (above != NO_BASIN && below != NO_BASIN) {
+                union_labels(parents, label_sizes, above, below);
             }
         }
     }
 
-    sort_numbers(basin_sizes, num_basins);
+    run_threads(strips, sizeof(basin_strip_type), num_threads,
+                find_basin_strip_roots);
+    basins.num_basins = 0;
+    for (i = 0; i < num_threads; i++) {
+        strips[i].first_basin = basins.num_basins;
+        basins.num_basins += strips[i].num_basins;
+    }
+    basins.sizes = malloc_b(MAX(1, basins.num_basins) * sizeof(size_t));
+    for (i = 0; i < num_threads; i++) {
+        strips[i].basin_sizes = basins.sizes;
+    }
+    run_threads(strips, sizeof(basin_strip_type), num_threads,
+                number_basin_strip_roots);
+    run_threads(strips, sizeof(basin_strip_type), num_threads,
+                number_basin_strip_labels);
+
+    free(strips);
+    strips = NULL;
+    free(label_sizes);
+    label_sizes = NULL;
+    free(parents);
+    parents = NULL;
+
+    return (basins);
+}
+
+/*
+ * make_basin_stream
+ *
+ * Make the state for streaming rows of a height map.
+ *
+ * Argument: width
+ *     Number of areas in each row.
+ *
+ * Return: basin_stream_type
+ */
+static basin_stream_type
+make_basin_stream(size_t width)
+{
+    basin_stream_type stream;
+    /* Each row has at most (width + 1) / 2 basins, and two rows are live */
+    size_t            num_slots = width + 2;
+    size_t            i;
+
+    assert(num_slots < NO_BASIN);
+
+    stream.width = width;
+    stream.num_rows = 0;
+    for (i = 0; i < 2; i++) {
+        stream.rows[i] = malloc_b(width + 2);
+        memset(stream.rows[i], WALL_HEIGHT, width + 2);
+        stream.labels[i] = malloc_b((width + 2) * sizeof(uint32_t));
+        memset(stream.labels[i], 0xff, (width + 2) * sizeof(uint32_t));
+    }
+    stream.is_candidate = calloc_b(width + 2, sizeof(bool));
+    stream.parents = malloc_b(num_slots * sizeof(uint32_t));
+    stream.sizes = malloc_b(num_slots * sizeof(size_t));
+    stream.roots = malloc_b(num_slots * sizeof(uint32_t));
+    stream.last_row = malloc_b(num_slots * sizeof(size_t));
+    stream.live_slots = malloc_b(num_slots * sizeof(uint32_t));
+    stream.num_live_slots = 0;
+    stream.free_slots = malloc_b(num_slots * sizeof(uint32_t));
+    for (i = 0; i < num_slots; i++) {
+        stream.free_slots[i] = num_slots - 1 - i;
+    }
+    stream.num_free_slots = num_slots;
+    memset(stream.largest_sizes, 0, sizeof(stream.largest_sizes));
+    stream.total_risk_level = 0;
+
+    return (stream);
+}
+
+/*
+ * free_basin_stream
+ *
+ * Free allocated memory from the basin stream struct.
+ *
+ * Argument: stream
+ *     basin_stream_type struct to free.
+ *
+ * Return: void
+ */
+static void
+free_basin_stream(basin_stream_type *stream)
+{
+    size_t i;
+
+    for (i = 0; i < 2; i++) {
+        free(stream->rows[i]);
+        stream->rows[i] = NULL;
+        free(stream->labels[i]);
+        stream->labels[i] = NULL;
+    }
+    free(stream->is_candidate);
+    stream->is_candidate = NULL;
+    free(stream->parents);
+    stream->parents = NULL;
+    free(stream->sizes);
+    stream->sizes = NULL;
+    free(stream->roots);
+    stream->roots = NULL;
+    free(stream->last_row);
+    stream->last_row = NULL;
+    free(stream->live_slots);
+    stream->live_slots = NULL;
+    free(stream->free_slots);
+    stream->free_slots = NULL;
+}
+
+/*
+ * add_closed_basin_size
+ *
+ * Add the size of a closed basin to the largest sizes if it is big enough.
+ *
+ * Argument: stream
+ *     Stream to add to.
+ * Argument: size
+ *     Size of the closed basin.
+ *
+ * Return: void
+ */
+static void
+add_closed_basin_size(basin_stream_type *stream, size_t size)
+{
+    size_t i;
+
+    for (i = NUM_LARGEST_BASINS; i > 0 && stream->largest_sizes[i - 1] < size;
+         i--) {
+        if (i < NUM_LARGEST_BASINS) {
+            stream->largest_sizes[i] = stream->largest_sizes[i - 1];
+        }
+    }
+    if (i < NUM_LARGEST_BASINS) {
+        stream->largest_sizes[i] = size;
+    }
+}
+
+/*
+ * close_finished_basins
+ *
+ * Once a row is labelled, point its labels at their roots, and close every
+ * basin which did not reach it. The slots of closed basins, and of labels
+ * which were joined into another, are freed for reuse.
+ *
+ * Argument: stream
+ *     Stream whose current row has just been labelled.
+ * Argument: labels
+ *     Labels of the current row.
+ *
+ * Return: void
+ */
+static void
+close_finished_basins(basin_stream_type *stream, uint32_t *labels)
+{
+    uint32_t slot;
+    size_t   num_kept = 0;
+    size_t   i;
+
+    for (i = 0; i < stream->num_live_slots; i++) {
+        slot = stream->live_slots[i];
+        stream->roots[slot] = find_label_root(stream->parents, slot);
+    }
+    for (i = 1; i <= stream->width; i++) {
+        if (labels[i] != NO_BASIN) {
+            labels[i] = stream->roots[labels[i]];
+            stream->last_row[labels[i]] = stream->num_rows;
+        }
+    }
+
+    for (i = 0; i < stream->num_live_slots; i++) {
+        slot = stream->live_slots[i];
+        if (stream->roots[slot] == slot
+            && stream->last_row[slot] == stream->num_rows) {
+            /* Still open */
+            stream->live_slots[num_kept++] = slot;
+            continue;
+        }
+        if (stream->roots[slot] == slot) {
+            add_closed_basin_size(stream, stream->sizes[slot]);
+        }
+        stream->free_slots[stream->num_free_slots++] = slot;
+    }
+    stream->num_live_slots = num_kept;
+}
+
+/*
+ * add_row_to_basin_stream
+ *
+ * Add the next row of heights. The previous row's low points are finished
+ * now the row below it is known, then the row is labelled against the
+ * previous one and basins which no longer reach it are closed.
+ *
+ * Argument: stream
+ *     Stream to add to.
+ * Argument: line
+ *     Row of width digits.
+ *
+ * Return: void
+ */
+static void
+add_row_to_basin_stream(basin_stream_type *stream, const char *line)
+{
+    uint8_t  *above = stream->rows[stream->num_rows % 2];
+    uint8_t  *row = stream->rows[(stream->num_rows + 1) % 2];
+    uint32_t *labels_above = stream->labels[stream->num_rows % 2];
+    uint32_t *labels = stream->labels[(stream->num_rows + 1) % 2];
+    uint32_t  left_label, above_label, label;
+    size_t    i;
+
+    for (i = 1; i <= stream->width; i++) {
+        row[i] = (uint8_t) (line[i - 1] - '0');
+    }
+
+    for (i = 1; i <= stream->width; i++) {
+        if (stream->is_candidate[i] && above[i] < row[i]) {
+            stream->total_risk_level += above[i] + 1;
+        }
+        stream->is_candidate[i] = (row[i] < row[i - 1] && row[i] < row[i + 1]
+                                   && row[i] < above[i]);
+    }
+
+    for (i = 1; i <= stream->width; i++) {
+        labels[i] = NO_BASIN;
+        if (row[i] == WALL_HEIGHT) {
+            continue;
+        }
+        left_label = labels[i - 1];
+        above_label = labels_above[i];
+        if (left_label == NO_BASIN && above_label == NO_BASIN) {
+            /* Start a new label in a free slot */
+            assert(stream->num_free_slots > 0);
+            label = stream->free_slots[--stream->num_free_slots];
+            stream->live_slots[stream->num_live_slots++] = label;
+            stream->parents[label] = label;
+            stream->sizes[label] = 0;
+        } else if (left_label == NO_BASIN) {
+            label = above_label;
+        } else if (above_label == NO_BASIN || above_label == left_label) {
+            label = left_label;
+        } else {
+            union_labels(stream->parents, stream->sizes, left_label,
+                         above_label);
+            label = left_label;
+        }
+        labels[i] = label;
+        stream->sizes[find_label_root(stream->parents, label)]++;
+    }
+
+    close_finished_basins(stream, labels);
+    stream->num_rows++;
+}
+
+/*
+ * finish_basin_stream
+ *
+ * Finish the last row's low points, with walls below it, and close every
+ * basin still open.
+ *
+ * Argument: stream
+ *     Stream to finish.
+ *
+ * Return: void
+ */
+static void
+finish_basin_stream(basin_stream_type *stream)
+{
+    uint8_t *row = stream->rows[stream->num_rows % 2];
+    size_t   i;
+
+    for (i = 1; i <= stream->width; i++) {
+        if (stream->is_candidate[i] && row[i] < WALL_HEIGHT) {
+            stream->total_risk_level += row[i] + 1;
+        }
+    }
+
+    for (i = 0; i < stream->num_live_slots; i++) {
+        add_closed_basin_size(stream, stream->sizes[stream->live_slots[i]]);
+        stream->free_slots[stream->num_free_slots++] = stream->live_slots[i];
+    }
+    stream->num_live_slots = 0;
+}
 
-    largest_basins_multipled = (basin_sizes[num_basins - 1]
-                                * basin_sizes[num_basins - 2]
-                                * basin_sizes[num_basins - 3]);
+/*
+ * stream_height_map
+ *
+ * Solve both parts reading a height map one row at a time from stdin or a
+ * file, so only two rows are held at once.
+ *
+ * Argument: file_name
+ *     File to read rows from, or "-" for stdin.
+ *
+ * Return: void
+ */
+static void
+stream_height_map(char *file_name)
+{
+    basin_stream_type  stream;
+    FILE              *fp = NULL;
+    char              *line = NULL;
+    size_t             line_size = 0;
+    ssize_t            len;
+    size_t             largest_basins_multipled = 1;
+    size_t             i;
+    bool               started = false;
+
+    if (STRS_EQUAL(file_name, "-")) {
+        fp = stdin;
+    } else {
+        fp = fopen(file_name, "r");
+        if (fp == NULL) {
+            fprintf(stderr, "Error opening file %s\n", file_name);
+            assert(false);
+        }
+    }
+
+    while ((len = getline(&line, &line_size, fp)) != -1) {
+        while (len > 0 && isspace(line[len - 1])) {
+            len--;
+        }
+        if (len == 0) {
+            continue;
+        }
+        if (!started) {
+            stream = make_basin_stream(len);
+            started = true;
+        }
+        assert((size_t) len == stream.width);
+        add_row_to_basin_stream(&stream, line);
+    }
+    assert(started);
+    finish_basin_stream(&stream);
 
-    free(basin_sizes);
+    for (i = 0; i < NUM_LARGEST_BASINS; i++) {
+        largest_basins_multipled *= stream.largest_sizes[i];
+    }
+    printf("Part 1: Total risk level of low points = %zu\n",
+           stream.total_risk_level);
+    printf("Part 2: 3 largest basin sizes multipled = %zu\n",
+           largest_basins_multipled);
+
+    free_basin_stream(&stream);
+    free(line);
+    line = NULL;
+    if (fp != stdin) {
+        fclose(fp);
+    }
+}
+
+/*
+ * make_generated_height_map
+ *
+ * Make a height map of random heights, with about two in five areas walls so
+ * there are many basins of mixed sizes, some crossing many rows. The same
+ * arguments always give the same map.
+ *
+ * Argument: width
+ *     How wide the area is (number of areas in each row).
+ * Argument: length
+ *     How long the area is (number of rows).
+ *
+ * Return: height_map_type
+ */
+static height_map_type
+make_generated_height_map(size_t width, size_t length)
+{
+    height_map_type height_map;
+    uint8_t        *row;
+    size_t          i, j;
+
+    assert(width > 0 && length > 0);
+    height_map = make_height_map(width, length);
+    srand(width * length);
+
+    for (i = 0; i < length; i++) {
+        row = &(height_map.heights[(i + 1) * height_map.stride + 1]);
+        for (j = 0; j < width; j++) {
+            row[j] = (uint8_t) MIN(rand() % 15, WALL_HEIGHT);
+        }
+    }
+
+    return (height_map);
+}
+
+/*
+ * print_generated_height_map
+ *
+ * Print a randomly generated height map in the puzzle's input format.
+ *
+ * Argument: width
+ *     How wide the area is (number of areas in each row).
+ * Argument: length
+ *     How long the area is (number of rows).
+ *
+ * Return: void
+ */
+static void
+print_generated_height_map(size_t width, size_t length)
+{
+    height_map_type height_map;
+    char           *line = NULL;
+    uint8_t        *row;
+    size_t          i, j;
+
+    height_map = make_generated_height_map(width, length);
+    line = malloc_b(width + 2);
+    line[width] = '\n';
+    line[width + 1] = '\0';
+
+    for (i = 0; i < length; i++) {
+        row = &(height_map.heights[(i + 1) * height_map.stride + 1]);
+        for (j = 0; j < width; j++) {
+            line[j] = (char) ('0' + row[j]);
+        }
+        fputs(line, stdout);
+    }
+
+    free(line);
+    line = NULL;
+    free_height_map(&height_map);
+}
+
+/*
+ * time_labelling
+ *
+ * Time labelling the basins of a height map, serially if num_threads is 0 or
+ * in parallel otherwise, and print the time.
+ *
+ * Argument: height_map
+ *     Height map to label.
+ * Argument: num_threads
+ *     Number of threads to use, or 0 for the serial label_basins.
+ * Argument: description
+ *     Description to print with the time.
+ *
+ * Return: size_t
+ *     The 3 largest basin sizes multiplied, to check against.
+ */
+static size_t
+time_labelling(height_map_type  height_map,
+               size_t           num_threads,
+               char            *description)
+{
+    basins_type      basins;
+    size_t           largest_basins_multipled;
+    struct timespec  start_time, end_time;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+    if (num_threads == 0) {
+        basins = label_basins(height_map);
+    } else {
+        basins = label_basins_parallel(height_map, num_threads);
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+    print_elapsed_time(find_elapsed_time_ns(start_time, end_time),
+                       description);
+
+    largest_basins_multipled = find_largest_basin_sizes_multiplied(basins);
+    free_basins(&basins);
 
     return (largest_basins_multipled);
 }
 
+/*
+ * report_scaling
+ *
+ * Time the serial labelling against the parallel one on generated maps, for
+ * every thread count from 1 to the number of online cores, and check they
+ * agree. Strong scaling keeps one map of length rows for every thread count.
+ * Weak scaling gives each thread length rows, so the map grows with the
+ * threads and ideally takes the same time.
+ *
+ * Argument: width
+ *     How wide the generated maps are.
+ * Argument: length
+ *     Number of rows of the strong scaling map, and per thread of the weak
+ *     scaling maps.
+ *
+ * Return: void
+ */
+static void
+report_scaling(size_t width, size_t length)
+{
+    height_map_type height_map;
+    size_t          expected;
+    size_t          num_threads, max_threads;
+    char            description[64];
+
+    max_threads = MAX(1, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%zu x %zu map, %zu cores\n", width, length, max_threads);
+
+    printf("Strong scaling:\n");
+    height_map = make_generated_height_map(width, length);
+    expected = time_labelling(height_map, 0, "Serial");
+    for (num_threads = 1; num_threads <= max_threads; num_threads++) {
+        snprintf(description, sizeof(description), "Parallel, %zu threads",
+                 num_threads);
+        assert(time_labelling(height_map, num_threads, description)
+               == expected);
+    }
+    free_height_map(&height_map);
+
+    printf("Weak scaling:\n");
+    for (num_threads = 1; num_threads <= max_threads; num_threads++) {
+        height_map = make_generated_height_map(width, length * num_threads);
+        snprintf(description, sizeof(description), "Serial, %zu rows",
+                 length * num_threads);
+        expected = time_labelling(height_map, 0, description);
+        snprintf(description, sizeof(description), "Parallel, %zu threads",
+                 num_threads);
+        assert(time_labelling(height_map, num_threads, description)
+               == expected);
+        free_height_map(&height_map);
+    }
+}
+
 /*
  * runner
  *
@@ -364,6 +1402,7 @@ runner(char *file_name, bool print_output)
 {
     parsed_text_type parsed_text;
     height_map_type  height_map;
+    basins_type      basins;
     size_t           total_risk_level;
     size_t           largest_basins_multipled;
 
@@ -372,34 +1411,59 @@ runner(char *file_name, bool print_output)
 
     height_map = parse_text_into_height_map(parsed_text);
 
-    identify_low_points(height_map);
-
-    total_risk_level = find_sum_of_risk_levels_of_low_points(height_map);
+    total_risk_level = find_low_points(height_map);
     if (print_output) {
         printf("Part 1: Total risk level of low points = %zu\n",
                total_risk_level);
     }
 
-    identify_basins(height_map);
-    largest_basins_multipled = find_3_largest_basin_sizes_multiplied(
-                                                                   height_map);
+    basins = label_basins_parallel(height_map,
+                                   find_num_threads(height_map.length
+                                                    * height_map.width,
+                                                    MIN_AREAS_PER_THREAD));
+    largest_basins_multipled = find_largest_basin_sizes_multiplied(basins);
     if (print_output) {
         printf("Part 2: 3 largest basin sizes multipled = %zu\n",
                largest_basins_multipled);
     }
 
-    free_height_map(height_map);
+    free_basins(&basins);
+    free_height_map(&height_map);
     free_parsed_text(parsed_text);
 }
 
 /*
  * Main function.
+ *
+ * Usage:
+ *   day_09 <file>
+ *       Solve both parts.
+ *   day_09 --stream <file|->
+ *       Solve both parts reading one row at a time from a file or stdin ("-").
+ *   day_09 --scaling <width> <length>
+ *       Time the serial and parallel basin labelling on generated maps.
+ *   day_09 --generate <width> <length>
+ *       Print a randomly generated height map.
  */
 int
 main(int argc, char **argv)
 {
     char *file_name = NULL;
 
+    if (argc == 3 && STRS_EQUAL(argv[1], "--stream")) {
+        stream_height_map(argv[2]);
+        return (0);
+    }
+    if (argc == 4 && STRS_EQUAL(argv[1], "--scaling")) {
+        report_scaling(strtoul(argv[2], NULL, 10), strtoul(argv[3], NULL, 10));
+        return (0);
+    }
+    if (argc == 4 && STRS_EQUAL(argv[1], "--generate")) {
+        print_generated_height_map(strtoul(argv[2], NULL, 10),
+                                   strtoul(argv[3], NULL, 10));
+        return (0);
+    }
+
     assert(argc == 2);
     file_name = argv[1];
 
@@ -2,26 +2,462 @@
  * AoC 2021 Day 10 solution
  */
 
+#include <immintrin.h>
+#include <unistd.h>
+
 #include "utils.h"
 
-/* Macros for identifying open/close brackets */
-#define IS_OPEN_BRACKET(char)   (char == '('                                  \
-                                 || char == '['                               \
-                                 || char == '{'                               \
-                                 || char == '<')
-#define IS_CLOSED_BRACKET(char) (char == ')'                                  \
-                                 || char == ']'                               \
-                                 || char == '}'                               \
-                                 || char == '>')
+/* Number of bytes in an AVX2 vector */
+#define AVX2_BYTES_PER_VECTOR 32
+
+/* Longest line printed by --generate */
+#define MAX_GENERATED_LINE_LEN 120
+
+/* Fewest bytes of lines worth giving a thread of their own */
+#define MIN_BYTES_PER_THREAD (1 << 18)
+
+/*
+ * bracket_kind_enum_type
+ *
+ * What a character of a line is.
+ *
+ * Element: NOT_A_BRACKET
+ *     Any character which is not a bracket.
+ * Element: OPEN_BRACKET
+ *     One of ([{<.
+ * Element: CLOSE_BRACKET
+ *     One of )]}>.
+ */
+typedef enum Bracket_Kind_Enum {
+    NOT_A_BRACKET = 0,
+    OPEN_BRACKET,
+    CLOSE_BRACKET,
+} bracket_kind_enum_type;
+
+/*
+ * bracket_class_type
+ *
+ * Everything needed to check a character of a line, looked up by the
+ * character.
+ *
+ * Element: kind
+ *     bracket_kind_enum_type of the character.
+ * Element: partner
+ *     Matching open bracket of a close bracket, or close bracket of an open
+ *     one.
+ * Element: score
+ *     Syntax error score of a close bracket, or autocomplete points of an open
+ *     one (for the close bracket added to match it).
+ */
+typedef struct Bracket_Class {
+    uint8_t  kind;
+    char     partner;
+    uint16_t score;
+} bracket_class_type;
+
+/*
+ * bracket_stack_type
+ *
+ * Stack of the open brackets not yet closed in a line, reused for every line
+ * so it is only ever grown.
+ *
+ * Element: brackets
+ *     Open brackets, the last opened at the top.
+ * Element: capacity
+ *     Number of brackets there is space for.
+ */
+typedef struct Bracket_Stack {
+    char   *brackets;
+    size_t  capacity;
+} bracket_stack_type;
+
+/*
+ * syntax_chunk_type
+ *
+ * Work for one thread of a parallel syntax check, a range of whole lines.
+ *
+ * Element: text
+ *     Text of lines to check.
+ * Element: start
+ *     Offset of the first line of the chunk.
+ * Element: end
+ *     Offset one past the last line of the chunk.
+ * Element: autocomplete_scores
+ *     OUT: Array with space for the autocomplete score of every line of the
+ *          chunk, filled with those of the lines without syntax errors.
+ * Element: num_autocomplete_scores
+ *     OUT: Number of lines without syntax errors.
+ * Element: syntax_error_score
+ *     OUT: Syntax error score of the lines with syntax errors.
+ */
+typedef struct Syntax_Chunk {
+    char   *text;
+    size_t  start;
+    size_t  end;
+    size_t *autocomplete_scores;
+    size_t  num_autocomplete_scores;
+    size_t  syntax_error_score;
+} syntax_chunk_type;
+
+/*
+ * The class of every character, indexed by the character.
+ */
+static const bracket_class_type BRACKET_CLASSES[256] = {
+    ['('] = {OPEN_BRACKET, ')', 1},
+    ['['] = {OPEN_BRACKET, ']', 2},
+    ['{'] = {OPEN_BRACKET, '}', 3},
+    ['<'] = {OPEN_BRACKET, '>', 4},
+    [')'] = {CLOSE_BRACKET, '(', 3},
+    [']'] = {CLOSE_BRACKET, '[', 57},
+    ['}'] = {CLOSE_BRACKET, '{', 1197},
+    ['>'] = {CLOSE_BRACKET, '<', 25137},
+};
+
+/*
+ * make_bracket_stack
+ *
+ * Make an empty bracket stack.
+ *
+ * Return: bracket_stack_type
+ */
+static bracket_stack_type
+make_bracket_stack(void)
+{
+    bracket_stack_type stack;
+
+    stack.capacity = 0;
+    stack.brackets = NULL;
+
+    return (stack);
+}
+
+/*
+ * reserve_bracket_stack
+ *
+ * Make sure a bracket stack has space for every bracket of a line, and a
+ * whole vector stored past the last of them.
+ *
+ * Argument: stack
+ *     Stack to grow if needed.
+ * Argument: len
+ *     Length of the line.
+ *
+ * Return: void
+ */
+static void
+reserve_bracket_stack(bracket_stack_type *stack, size_t len)
+{
+    if (len + AVX2_BYTES_PER_VECTOR > stack->capacity) {
+        stack->capacity = MAX(2 * stack->capacity,
+                              len + AVX2_BYTES_PER_VECTOR);
+        stack->brackets = realloc_b(stack->brackets, stack->capacity);
+    }
+}
+
+/*
+ * free_bracket_stack
+ *
+ * Free allocated memory from the bracket stack struct.
+ *
+ * Argument: stack
+ *     bracket_stack_type struct to free.
+ *
+ * Return: void
+ */
+static void
+free_bracket_stack(bracket_stack_type *stack)
+{
+    free(stack->brackets);
+    stack->brackets = NULL;
+    stack->capacity = 0;
+}
+
+/*
+ * find_autocomplete_score
+ *
+ * Score the close brackets needed to complete a line, which match the open
+ * brackets left on the stack from the top down.
+ *
+ * Argument: stack
+ *     Stack of the line's unclosed brackets.
+ * Argument: depth
+ *     Number of brackets on the stack.
+ *
+ * Return: size_t
+ */
+static size_t
+find_autocomplete_score(bracket_stack_type *stack, size_t depth)
+{
+    size_t score = 0;
+
+    while (depth > 0) {
+        score = score * 5
+                + BRACKET_CLASSES[(uint8_t) stack->brackets[--depth]].score;
+    }
+
+    return (score);
+}
+
+/*
+ * check_line_syntax
+ *
+ * Check the brackets of a line, one character at a time. Open brackets are
+ * pushed on the stack, and each close bracket must match the top of the
+ * stack, which it pops.
+ *
+ * Argument: line
+ *     Line to check.
+ * Argument: len
+ *     Length of the line, without the newline.
+ * Argument: stack
+ *     Stack to use, with space for the line.
+ * Argument: score
+ *     OUT: Syntax error score of the first illegal character if the line is
+ *          corrupted, otherwise the autocomplete score of the line.
+ *
+ * Return: bool
+ *     Whether the line is corrupted.
+ */
+static bool
+check_line_syntax(const char         *line,
+                  size_t              len,
+                  bracket_stack_type *stack,
+                  size_t             *score)
+{
+    bracket_class_type  class;
+    size_t              depth = 0;
+    size_t              i;
+
+    for (i = 0; i < len; i++) {
+        class = BRACKET_CLASSES[(uint8_t) line[i]];
+        if (class.kind == OPEN_BRACKET) {
+            stack->brackets[depth++] = line[i];
+        } else if (depth > 0 && stack->brackets[depth - 1] == class.partner) {
+            depth--;
+        } else {
+            /* Not the matching close bracket, or nothing to close */
+            assert(class.kind == CLOSE_BRACKET);
+            *score = class.score;
+            return (true);
+        }
+    }
+    *score = find_autocomplete_score(stack, depth);
+
+    return (false);
+}
+
+/*
+ * check_line_syntax_avx2
+ *
+ * Check the brackets of a line as check_line_syntax does, except where a
+ * vector of the line starts with open brackets they are all pushed with one
+ * store, as lines are mostly runs of open brackets between close ones.
+ *
+ * Argument: line
+ *     Line to check.
+ * Argument: len
+ *     Length of the line, without the newline.
+ * Argument: stack
+ *     Stack to use, with space for the line and a vector past it.
+ * Argument: score
+ *     OUT: Syntax error score of the first illegal character if the line is
+ *          corrupted, otherwise the autocomplete score of the line.
+ *
+ * Return: bool
+ *     Whether the line is corrupted.
+ */
+__attribute__((target("avx2,bmi")))
+static bool
+check_line_syntax_avx2(const char         *line,
+                       size_t              len,
+                       bracket_stack_type *stack,
+                       size_t             *score)
+{
+    bracket_class_type  class;
+    __m256i             v, is_open;
+    uint32_t            open_mask;
+    size_t              run;
+    size_t              depth = 0;
+    size_t              i = 0;
+
+    while (i < len) {
+        if (i + AVX2_BYTES_PER_VECTOR <= len) {
+            v = _mm256_loadu_si256((__m256i *) &line[i]);
+            is_open = _mm256_or_si256(
+                        _mm256_or_si256(
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('(')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('['))),
+                        _mm256_or_si256(
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('{')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('<'))));
+            open_mask = (uint32_t) _mm256_movemask_epi8(is_open);
+            /* Push the whole vector, only the leading open brackets count */
+            _mm256_storeu_si256((__m256i *) &stack->brackets[depth], v);
+            run = _tzcnt_u32(~open_mask);
+            depth += run;
+            i += run;
+            if (run == AVX2_BYTES_PER_VECTOR) {
+                continue;
+            }
+        }
+
+        class = BRACKET_CLASSES[(uint8_t) line[i]];
+        if (class.kind == OPEN_BRACKET) {
+            stack->brackets[depth++] = line[i];
+        } else if (depth > 0 && stack->brackets[depth - 1] == class.partner) {
+            depth--;
+        } else {
+            /* Not the matching close bracket, or nothing to close */
+            assert(class.kind == CLOSE_BRACKET);
+            *score = class.score;
+            return (true);
+        }
+        i++;
+    }
+    *score = find_autocomplete_score(stack, depth);
+
+    return (false);
+}
+
+/*
+ * check_syntax_chunk
+ *
+ * Thread function to check the syntax of a chunk of lines straight from the
+ * text, with the thread's own bracket stack.
+ *
+ * Argument: arg
+ *     Pointer to the syntax_chunk_type to check.
+ *
+ * Return: void *
+ */
+static void *
+check_syntax_chunk(void *arg)
+{
+    syntax_chunk_type  *chunk = arg;
+    bracket_stack_type  stack;
+    char               *line = &chunk->text[chunk->start];
+    char               *end = &chunk->text[chunk->end];
+    char               *newline;
+    size_t              line_len;
+    size_t              score;
+    bool                is_syntax_error;
+    bool                use_avx2;
+
+    stack = make_bracket_stack();
+    use_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi");
+
+    chunk->syntax_error_score = 0;
+    chunk->num_autocomplete_scores = 0;
+    while (line < end) {
+        newline = memchr(line, '\n', end - line);
+        if (newline == NULL) {
+            newline = end;
+        }
+        line_len = newline - line;
+        if (line_len > 0 && line[line_len - 1] == '\r') {
+            line_len--;
+        }
+        if (line_len > 0) {
+            reserve_bracket_stack(&stack, line_len);
+            if (use_avx2) {
+                is_syntax_error = check_line_syntax_avx2(line, line_len,
+                                                         &stack, &score);
+            } else {
+                is_syntax_error = check_line_syntax(line, line_len, &stack,
+                                                    &score);
+            }
+            if (is_syntax_error) {
+                chunk->syntax_error_score += score;
+            } else {
+                chunk->autocomplete_scores[chunk->num_autocomplete_scores++] =
+                                                                        score;
+            }
+        }
+        line = newline + 1;
+    }
+
+    free_bracket_stack(&stack);
+
+    return (NULL);
+}
+
+/*
+ * select_middle_score
+ *
+ * Find the middle score as if the scores were sorted, with a quickselect.
+ * Each pass splits the scores three ways, below, equal to and above the
+ * pivot, and stops once the middle falls among those equal to it, so many
+ * equal scores still take linear time on average rather than sorting.
+ *
+ * Argument: scores
+ *     Array of scores. Reordered so the middle score is in place.
+ * Argument: num_scores
+ *     Number of elements in the array.
+ *
+ * Return: size_t
+ */
+static size_t
+select_middle_score(size_t *scores, size_t num_scores)
+{
+    size_t k = num_scores / 2;
+    size_t low = 0;
+    size_t high = num_scores;
+    size_t pivot, swap;
+    size_t less, greater, i;
+
+    assert(num_scores > 0);
+
+    while (high - low > 1) {
+        /*
+         * Partition around the middle element, so [low, less) are smaller,
+         * [less, greater) are equal and [greater, high) are larger.
+         */
+        pivot = scores[low + (high - low) / 2];
+        less = low;
+        greater = high;
+        i = low;
+        while (i < greater) {
+            if (scores[i] < pivot) {
+                swap = scores[i];
+                scores[i++] = scores[less];
+                scores[less++] = swap;
+            } else if (scores[i] > pivot) {
+                swap = scores[i];
+                scores[i] = scores[--greater];
+                scores[greater] = swap;
+            } else {
+                i++;
+            }
+        }
+
+        if (k < less) {
+            high = less;
+        } else if (k >= greater) {
+            low = greater;
+        } else {
+            /* Among the scores equal to the pivot */
+            break;
+        }
+    }
+
+    return (scores[k]);
+}
 
 /*
  * find_syntax_error_and_autocomplete_scores
  *
- * Find the syntax error score for the lines in the parsed text with syntax
- * errors and the autocomplete scores for the lines without syntax errors.
+ * Find the syntax error score for the lines of text with syntax errors and
+ * the autocomplete score for the lines without syntax errors. The text is
+ * split at line boundaries into one chunk per thread, each checked with its
+ * own bracket stack into its own part of the autocomplete scores. The parts
+ * are then joined and the middle score selected.
  *
- * Argument: parsed_text
- *     Parsed text struct of lines to check the syntax of.
+ * Argument: text
+ *     Text of lines to check the syntax of.
+ * Argument: len
+ *     Length of the text.
+ * Argument: num_threads
+ *     Number of threads to use.
  * Argument: syntax_error_score
  *     OUT: Syntax error score calculated from the lines with syntax errors.
  * Argument: autocomplete_score
@@ -30,145 +466,164 @@
  * Return: void
  */
 static void
-find_syntax_error_and_autocomplete_scores(parsed_text_type  parsed_text,
-                                          size_t           *syntax_error_score,
-                                          size_t           *autocomplete_score)
+find_syntax_error_and_autocomplete_scores(char   *text,
+                                          size_t  len,
+                                          size_t  num_threads,
+                                          size_t *syntax_error_score,
+                                          size_t *autocomplete_score)
 {
-    size_t  i, j;
-    size_t  max_str_len;
-    char    c;
-    char   *open_bracket_buffer = NULL;
-    size_t  current_buffer_pos;
-    bool    is_syntax_error;
-    size_t  num_non_syntax_error_lines;
-    size_t *autocomplete_scores = NULL;
-
-    /* Find max length of a line and allocate a buffer which can fit it */
-    max_str_len = 0;
-    for (i = 0; i < parsed_text.num_lines; i++) {
-        if (parsed_text.lines[i].len > max_str_len) {
-            max_str_len = parsed_text.lines[i].len;
-        }
-    }
-    open_bracket_buffer = malloc_b(max_str_len + 1);
+    syntax_chunk_type *chunks = NULL;
+    size_t            *autocomplete_scores = NULL;
+    size_t             num_non_syntax_error_lines;
+    size_t             boundary;
+    size_t             i;
+
+    assert(num_threads > 0);
 
     /*
      * Over-allocate memory for the autocomplete scores array as we don't know
-     * how many there will be.
+     * how many there will be. Every line is at least a bracket and a newline,
+     * so a chunk starting at offset start has at most (end - start) / 2 + 1
+     * lines, and gets the space from start / 2 + its index.
      */
-    autocomplete_scores = malloc_b(parsed_text.num_lines * sizeof(size_t));
+    autocomplete_scores = malloc_b((len / 2 + num_threads) * sizeof(size_t));
+    chunks = malloc_b(num_threads * sizeof(syntax_chunk_type));
+    boundary = 0;
+    for (i = 0; i < num_threads; i++) {
+        chunks[i].text = text;
+        chunks[i].start = boundary;
+        boundary = find_line_boundary(text, len,
+                                      MAX(boundary,
+                                          len * (i + 1) / num_threads));
+        chunks[i].end = boundary;
+        chunks[i].autocomplete_scores = &autocomplete_scores[
+                                                  chunks[i].start / 2 + i];
+    }
+
+    run_threads(chunks, sizeof(syntax_chunk_type), num_threads,
+                check_syntax_chunk);
 
-    /*
-     * For each line, build up a buffer of open bracket types. When we
-     * encounter a close bracket, make sure it is the the same bracket type as
-     * the last open bracket on the buffer. If it is, remove that bracket from
-     * the buffer and continue, if it is not the same there is a syntax error.
-     *
-     * Keep track of the syntax error score if there is an error and the
-     * autocomplete scores if there is not.
-     */
     *syntax_error_score = 0;
     num_non_syntax_error_lines = 0;
-    for (i = 0; i < parsed_text.num_lines; i++) {
-        /* Reset the buffer to null characters */
-        memset(open_bracket_buffer, '\0', max_str_len + 1);
-        current_buffer_pos = 0;
-        is_syntax_error = false;
-
-        for (j = 0; j < parsed_text.lines[i].len; j++) {
-            c = parsed_text.lines[i].line[j];
-            if (IS_OPEN_BRACKET(c)) {
-                /* Is an open bracket, put it on the buffer */
-                open_bracket_buffer[current_buffer_pos++] = c;
-            } else if (IS_CLOSED_BRACKET(c)) {
-                /*
-                 * Is a closed bracket, check the last char on the buffer was
-                 * the equivalent open bracket.
-                 */
-                if (current_buffer_pos == 0
-                    || (c == ')' && open_bracket_buffer[current_buffer_pos-1] != '(')
-                    || (c == ']' && open_bracket_buffer[current_buffer_pos-1] != '[')
-                    || (c == '}' && open_bracket_buffer[current_buffer_pos-1] != '{')
-                    || (c == '>' && open_bracket_buffer[current_buffer_pos-1] != '<')) {
-                    /*
-                     * Was not the matching open bracket, or there was no
-                     * previous open bracket -> syntax error.
-                     */
-                    is_syntax_error = true;
-                    switch (c) {
-                        case ')':
-                            *syntax_error_score += 3;
-                            break;
-                        case ']':
-                            *syntax_error_score += 57;
-                            break;
-                        case '}':
-                            *syntax_error_score += 1197;
-                            break;
-                        case '>':
-                            *syntax_error_score += 25137;
-                            break;
-                        default:
-                            assert(false);
-                    }
-                    break;
-                } else {
-                    /* Was a matching bracket, pop it from the buffer */
-                    open_bracket_buffer[--current_buffer_pos] = '\0';
-                }
-            } else {
-                assert(false);
-            }
-        }
-        if (!is_syntax_error) {
-            /*
-             * We made it to the end of the line without finding any syntax
-             * errors. Have now got the buffer of remaining open brackets. The
-             * order of the matching close brackets is simply the reverse of
-             * the buffer.
-             */
-            *autocomplete_score = 0;
-            for (; current_buffer_pos >= 1; current_buffer_pos--) {
-                c = open_bracket_buffer[current_buffer_pos - 1];
-                *autocomplete_score *= 5;
-                switch (c) {
-                    case '(':
-                        *autocomplete_score += 1;
-                        break;
-                    case '[':
-                        *autocomplete_score += 2;
-                        break;
-                    case '{':
-                        *autocomplete_score += 3;
-                        break;
-                    case '<':
-                        *autocomplete_score += 4;
-                        break;
-                    default:
-                        assert(false);
-                }
-            }
-            autocomplete_scores[num_non_syntax_error_lines++] =
-                                                           *autocomplete_score;
-        }
+    for (i = 0; i < num_threads; i++) {
+        *syntax_error_score += chunks[i].syntax_error_score;
+        memmove(&autocomplete_scores[num_non_syntax_error_lines],
+                chunks[i].autocomplete_scores,
+                chunks[i].num_autocomplete_scores * sizeof(size_t));
+        num_non_syntax_error_lines += chunks[i].num_autocomplete_scores;
     }
 
-    /* Realloc the autocomplete_scores array to have the right size */
-    autocomplete_scores = realloc_b(
-                                  autocomplete_scores,
-                                  num_non_syntax_error_lines * sizeof(size_t));
-
     /*
      * The final autocomplete score is the middle value when sorted.
      */
-    sort_long_numbers(autocomplete_scores, num_non_syntax_error_lines);
-    *autocomplete_score = autocomplete_scores[num_non_syntax_error_lines / 2];
+    *autocomplete_score = select_middle_score(autocomplete_scores,
+                                              num_non_syntax_error_lines);
 
+    free(chunks);
+    chunks = NULL;
     free(autocomplete_scores);
     autocomplete_scores = NULL;
+}
+
+/*
+ * report_scaling
+ *
+ * Time checking the lines for every thread count from 1 to the number of
+ * online cores, and check they agree.
+ *
+ * Argument: file_name
+ *     File of lines to time on.
+ *
+ * Return: void
+ */
+static void
+report_scaling(char *file_name)
+{
+    char            *text = NULL;
+    size_t           text_len;
+    size_t           expected_1, expected_2;
+    size_t           part_1, part_2;
+    size_t           num_threads, max_threads;
+    struct timespec  start_time, end_time;
+    uint64_t         elapsed_ns;
+    char             description[64];
+
+    text = map_file(file_name, &text_len);
+    max_threads = MAX(1, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%zu bytes, %zu cores\n", text_len, max_threads);
+
+    for (num_threads = 1; num_threads <= max_threads; num_threads++) {
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+        find_syntax_error_and_autocomplete_scores(text, text_len, num_threads,
+                                                  &part_1, &part_2);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+        if (num_threads == 1) {
+            expected_1 = part_1;
+            expected_2 = part_2;
+        }
+        assert(part_1 == expected_1);
+        assert(part_2 == expected_2);
+        elapsed_ns = find_elapsed_time_ns(start_time, end_time);
+        snprintf(description, sizeof(description),
+                 "Parallel, %zu threads (%.3g MB/s/thread)", num_threads,
+                 text_len * 1e3 / MAX(1, elapsed_ns) / num_threads);
+        print_elapsed_time(elapsed_ns, description);
+    }
 
-    free(open_bracket_buffer);
-    open_bracket_buffer = NULL;
+    munmap(text, text_len);
+    text = NULL;
+}
+
+/*
+ * print_generated_lines
+ *
+ * Print random lines of brackets in the puzzle's input format. About half
+ * the lines are corrupted by one wrong close bracket, and the rest are left
+ * incomplete. The same number of lines always gives the same lines.
+ *
+ * Argument: num_lines
+ *     Number of lines to print.
+ *
+ * Return: void
+ */
+static void
+print_generated_lines(size_t num_lines)
+{
+    static const char  open_brackets[] = "([{<";
+    static const char  close_brackets[] = ")]}>";
+    char               line[MAX_GENERATED_LINE_LEN + 2];
+    char               stack[MAX_GENERATED_LINE_LEN];
+    size_t             line_len, corrupt_at;
+    size_t             depth;
+    size_t             i, j, k;
+
+    srand(num_lines);
+
+    for (i = 0; i < num_lines; i++) {
+        line_len = MAX_GENERATED_LINE_LEN / 2
+                   + rand() % (MAX_GENERATED_LINE_LEN / 2);
+        /* Past the end of the line if it is left incomplete */
+        corrupt_at = (rand() % 2) ? rand() % line_len : line_len;
+        depth = 0;
+        for (j = 0; j < line_len; j++) {
+            if (depth > 0 && rand() % 5 < 2) {
+                line[j] = BRACKET_CLASSES[(uint8_t) stack[--depth]].partner;
+                if (j >= corrupt_at) {
+                    /* Change to one of the other close brackets */
+                    k = strchr(open_brackets, stack[depth]) - open_brackets;
+                    line[j] = close_brackets[(k + 1 + rand() % 3) % 4];
+                    j++;
+                    break;
+                }
+            } else {
+                line[j] = open_brackets[rand() % 4];
+                stack[depth++] = line[j];
+            }
+        }
+        line[j] = '\n';
+        line[j + 1] = '\0';
+        fputs(line, stdout);
+    }
 }
 
 /*
@@ -187,13 +642,17 @@ find_syntax_error_and_autocomplete_scores(parsed_text_type  parsed_text,
 static void
 runner(char *file_name, bool print_output)
 {
-    parsed_text_type   parsed_text;
-    size_t             syntax_error_score;
-    size_t             autocomplete_score;
+    char   *text = NULL;
+    size_t  text_len;
+    size_t  syntax_error_score;
+    size_t  autocomplete_score;
 
-    parsed_text = parse_file(file_name);
+    text = read_file_to_buffer(file_name, &text_len);
 
-    find_syntax_error_and_autocomplete_scores(parsed_text,
+    find_syntax_error_and_autocomplete_scores(text, text_len,
+                                              find_num_threads(
+                                                      text_len,
+                                                      MIN_BYTES_PER_THREAD),
                                               &syntax_error_score,
                                               &autocomplete_score);
     if (print_output) {
@@ -201,17 +660,36 @@ runner(char *file_name, bool print_output)
         printf("Part 2: Autocomplete score = %zu\n", autocomplete_score);
     }
 
-    free_parsed_text(parsed_text);
+    free(text);
+    text = NULL;
 }
 
 /*
  * Main function.
+ *
+ * Usage:
+ *   day_10 <file>
+ *       Solve both parts.
+ *   day_10 --scaling <file>
+ *       Time checking the lines for every number of threads up to the number
+ *       of cores.
+ *   day_10 --generate <num_lines>
+ *       Print random incomplete and corrupted lines.
  */
 int
 main(int argc, char **argv)
 {
     char *file_name = NULL;
 
+    if (argc == 3 && STRS_EQUAL(argv[1], "--scaling")) {
+        report_scaling(argv[2]);
+        return (0);
+    }
+    if (argc == 3 && STRS_EQUAL(argv[1], "--generate")) {
+        print_generated_lines(strtoul(argv[2], NULL, 10));
+        return (0);
+    }
+
     assert(argc == 2);
     file_name = argv[1];
 
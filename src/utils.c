@@ -2,6 +2,11 @@
  * Common helper utils
  */
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "utils.h"
 
 /*
@@ -150,6 +155,123 @@ parse_file(char *file_name)
     return (parsed_text);
 }
 
+/*
+ * Doc in utils.h
+ */
+char *
+read_file_to_buffer(char *file_name, size_t *len)
+{
+    FILE   *fp = NULL;
+    char   *buffer = NULL;
+    long    file_size;
+
+    fp = fopen(file_name, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "Error opening file %s\n", file_name);
+        assert(false);
+    }
+
+    fseek(fp, 0, SEEK_END);
+    file_size = ftell(fp);
+    assert(file_size >= 0);
+    fseek(fp, 0, SEEK_SET);
+
+    buffer = malloc_b(file_size + 1);
+    *len = fread(buffer, 1, file_size, fp);
+    buffer[*len] = '\0';
+
+    fclose(fp);
+    fp = NULL;
+
+    return (buffer);
+}
+
+/*
+ * Doc in utils.h
+ */
+char *
+map_file(char *file_name, size_t *len)
+{
+    struct stat  file_stat;
+    char        *text = NULL;
+    int          fd;
+
+    fd = open(file_name, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error opening file %s\n", file_name);
+        assert(false);
+    }
+    fstat(fd, &file_stat);
+    *len = file_stat.st_size;
+    assert(*len > 0);
+
+    text = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+    assert(text != MAP_FAILED);
+    close(fd);
+
+    return (text);
+}
+
+/*
+ * Doc in utils.h
+ */
+size_t
+find_line_boundary(char *text, size_t len, size_t pos)
+{
+    while (pos > 0 && pos < len && text[pos - 1] != '\n') {
+        pos++;
+    }
+
+    return (pos);
+}
+
+/*
+ * Doc in utils.h
+ */
+void
+run_threads(void   *items,
+            size_t  item_size,
+            size_t  num_items,
+            void *(*thread_func)(void *))
+{
+    pthread_t *threads = NULL;
+    int        rc;
+    size_t     i;
+
+    if (num_items == 1) {
+        thread_func(items);
+        return;
+    }
+
+    threads = malloc_b(num_items * sizeof(pthread_t));
+    for (i = 0; i < num_items; i++) {
+        rc = pthread_create(&threads[i], NULL, thread_func,
+                            (char *) items + i * item_size);
+        assert(rc == 0);
+    }
+    for (i = 0; i < num_items; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    threads = NULL;
+}
+
+/*
+ * Doc in utils.h
+ */
+size_t
+find_num_threads(size_t work, size_t min_work_per_thread)
+{
+    if (work < 2 * min_work_per_thread) {
+        /* Not worth asking how many cores there are */
+        return (1);
+    }
+
+    return (MIN((size_t) MAX(1, sysconf(_SC_NPROCESSORS_ONLN)),
+                work / min_work_per_thread));
+}
+
 /*
  * Doc in utils.h
  */
@@ -453,6 +575,16 @@ print_elapsed_time(double runtime_ns, char *description)
     }
 }
 
+/*
+ * Doc in utils.h
+ */
+double
+find_elapsed_time_ns(struct timespec start_time, struct timespec end_time)
+{
+    return ((end_time.tv_sec - start_time.tv_sec) * 1e9 +
+            (end_time.tv_nsec - start_time.tv_nsec));
+}
+
 /*
  * Doc in utils.h
  */
@@ -12,6 +12,7 @@
 #include <math.h>
 #include <time.h>
 #include <sys/param.h>
+#include <sys/mman.h>
 
 #ifndef __UTILS_H__
 #define __UTILS_H__
@@ -87,6 +88,99 @@ void *realloc_b(void *ptr, size_t size);
  */
 parsed_text_type parse_file(char *file_name);
 
+/*
+ * read_file_to_buffer
+ *
+ * Read the whole of a file into a single null-terminated buffer, without
+ * splitting it into lines. The memory of the returned buffer must be freed by
+ * the caller.
+ *
+ * Argument: file_name
+ *     Name of the file to read.
+ * Argument: len
+ *     OUT: Number of bytes read, not including the null terminator.
+ *
+ * Return: char *
+ *
+ */
+char *read_file_to_buffer(char *file_name, size_t *len);
+
+/*
+ * map_file
+ *
+ * Map a whole file read-only into memory. The returned pointer must be
+ * unmapped with munmap() by the caller.
+ *
+ * Argument: file_name
+ *     Name of the file to map.
+ * Argument: len
+ *     OUT: Number of bytes in the file.
+ *
+ * Return: char *
+ *
+ */
+char *map_file(char *file_name, size_t *len);
+
+/*
+ * find_line_boundary
+ *
+ * Move an offset into text forward to the start of the next line, so text can
+ * be split into chunks without splitting a line. Offsets already at the start
+ * of a line (or the start or end of the text) are returned unchanged.
+ *
+ * Argument: text
+ *     Text to search. Does not need to be null terminated.
+ * Argument: len
+ *     Number of bytes in text.
+ * Argument: pos
+ *     Offset to move forward.
+ *
+ * Return: size_t
+ *
+ */
+size_t find_line_boundary(char *text, size_t len, size_t pos);
+
+/*
+ * run_threads
+ *
+ * Run a thread function on each item of an array, one thread per item, and
+ * wait for them all to finish. A single item is run on the calling thread, as
+ * starting a thread would cost more than it saves.
+ *
+ * Argument: items
+ *     Array of num_items items, each passed to thread_func.
+ * Argument: item_size
+ *     Size of each item in bytes.
+ * Argument: num_items
+ *     Number of items, and so threads.
+ * Argument: thread_func
+ *     Function to run on each item.
+ *
+ * Return: void
+ *
+ */
+void run_threads(void   *items,
+                 size_t  item_size,
+                 size_t  num_items,
+                 void *(*thread_func)(void *));
+
+/*
+ * find_num_threads
+ *
+ * Pick how many threads to split some work over, one per online core but only
+ * one per min_work_per_thread units of work, as a thread with less to do
+ * costs more to start than it saves. Never less than 1.
+ *
+ * Argument: work
+ *     Amount of work, in any unit.
+ * Argument: min_work_per_thread
+ *     Least work worth giving a thread of its own, in the same unit.
+ *
+ * Return: size_t
+ *
+ */
+size_t find_num_threads(size_t work, size_t min_work_per_thread);
+
 /*
  * free_parsed_text
  *
@@ -269,6 +363,22 @@ parsed_text_type split_string_on_char(char *text, char split_on);
  */
 void print_elapsed_time(double elapsed_time_ns, char *description);
 
+/*
+ * find_elapsed_time_ns
+ *
+ * Find the time in nanoseconds between two times.
+ *
+ * Argument: start_time
+ *     Time at the start.
+ * Argument: end_time
+ *     Time at the end.
+ *
+ * Return: double
+ *
+ */
+double find_elapsed_time_ns(struct timespec start_time,
+                            struct timespec end_time);
+
 /*
  * run_main_func_with_benchmark
  *